@@ -0,0 +1,150 @@
+#ifndef __ADAPTIVE_MUTEX__H__
+#define __ADAPTIVE_MUTEX__H__
+
+#include <atomic>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+// A mutex for critical sections that last nanoseconds. With std::mutex a
+// thread that finds the lock taken soon ends up in the kernel, which costs
+// far more than the critical section itself. AdaptiveMutex first spins with
+// exponential backoff (pause instructions, doubling each round), and only
+// parks on a futex when the spin budget runs out.
+//
+// The budget adapts: every time a spinning thread gets the lock, the number
+// of pauses it took is a measure of how long the holder kept it, and the
+// budget moves towards twice a running average of that. Every time the
+// budget runs out instead, it's halved, down to minSpin: if the lock is held
+// long, spinning keeps failing and threads soon park almost at once; if it's
+// held briefly, spinning succeeds cheaply and the budget grows back.
+//
+// Locked state follows Drepper's "Futexes Are Tricky": 0 free, 1 locked,
+// 2 locked and maybe someone parked, so unlock only enters the kernel when
+// there may be a sleeper. Outside Linux, parking falls back to yielding.
+// On a single-CPU machine spinning can only delay the holder, so it's skipped.
+//
+// It meets the Lockable requirements (lock, try_lock, unlock).
+class AdaptiveMutex {
+public:
+    enum : int { minSpin = 16, maxSpin = 4096 };
+
+    AdaptiveMutex() = default;
+    AdaptiveMutex(const AdaptiveMutex&) = delete;
+    AdaptiveMutex& operator=(const AdaptiveMutex&) = delete;
+
+    bool try_lock() noexcept
+    {
+        int expected = 0;
+        return state.compare_exchange_strong(expected, 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    }
+
+    void lock() noexcept
+    {
+        if (try_lock())
+            return;
+        if (spin())
+            return;
+        // Mark the lock contended before sleeping, so the holder's unlock
+        // knows to wake someone. Whoever takes it this way also leaves 2
+        // behind, since other sleepers may still exist.
+        while (state.exchange(2, std::memory_order_acquire) != 0)
+            park();
+    }
+
+    void unlock() noexcept
+    {
+        if (state.exchange(0, std::memory_order_release) == 2)
+            wake();
+    }
+
+    // The current spin budget, in pause instructions.
+    int spinBudget() const noexcept { return budget.load(std::memory_order_relaxed); }
+
+private:
+    static void pause() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // true if the lock was taken while spinning
+    bool spin() noexcept
+    {
+        // On a single CPU the holder can't run while we spin.
+        static const bool multiCore = std::thread::hardware_concurrency() > 1;
+        if (!multiCore)
+            return false;
+        const int limit = budget.load(std::memory_order_relaxed);
+        int spent = 0;
+        for (int backoff = 1; spent < limit; backoff = backoff < 64 ? backoff * 2 : 64) {
+            for (int i = 0; i < backoff; ++i)
+                pause();
+            spent += backoff;
+            // test before test-and-set, so spinning doesn't bounce the line
+            if (state.load(std::memory_order_relaxed) == 0 && try_lock()) {
+                adapt(spent);
+                return true;
+            }
+        }
+        shrink();
+        return false;
+    }
+
+    // budget += (2 * spent - budget) / 8, clamped. Racy on purpose: it's a
+    // heuristic and a lost update doesn't matter.
+    void adapt(int spent) noexcept
+    {
+        int b = budget.load(std::memory_order_relaxed);
+        b += (2 * spent - b) / 8;
+        b = b < minSpin ? minSpin : (b > maxSpin ? maxSpin : b);
+        budget.store(b, std::memory_order_relaxed);
+    }
+
+    // after a spin that ran out: spinning is wasted while the lock is held
+    // this long, so the next waiters try less
+    void shrink() noexcept
+    {
+        int b = budget.load(std::memory_order_relaxed) / 2;
+        budget.store(b < minSpin ? minSpin : b, std::memory_order_relaxed);
+    }
+
+    void park() noexcept
+    {
+#if defined(__linux__)
+        // sleeps only if state is still 2 when the kernel looks
+        syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAIT_PRIVATE, 2,
+                nullptr, nullptr, 0);
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    void wake() noexcept
+    {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAKE_PRIVATE, 1,
+                nullptr, nullptr, 0);
+#endif
+    }
+
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex needs a plain int");
+
+    std::atomic<int> state { 0 };
+    std::atomic<int> budget { 256 };
+};
+
+#endif // __ADAPTIVE_MUTEX__H__
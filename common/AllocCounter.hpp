@@ -0,0 +1,210 @@
+#ifndef __ALLOC_COUNTER__H__
+#define __ALLOC_COUNTER__H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+
+// Counts every heap allocation the program makes by replacing the global
+// operator new and operator delete. Totals are always kept; in addition,
+// allocations made while an ALLOC_SITE scope is active on the current thread
+// are charged to that site, so a demo can say exactly which line allocated.
+//
+// Replacement allocation functions have to be defined exactly once per
+// program, so include this header from one translation unit only, the one
+// with main(). Every demo here is a single t.cpp, so that's always the case.
+namespace instrument {
+
+struct AllocStats {
+    std::size_t allocations { 0 };
+    std::size_t deallocations { 0 };
+    std::size_t bytes { 0 };
+};
+
+inline AllocStats operator-(const AllocStats& lhs, const AllocStats& rhs) noexcept
+{
+    return { lhs.allocations - rhs.allocations,
+             lhs.deallocations - rhs.deallocations,
+             lhs.bytes - rhs.bytes };
+}
+
+inline std::ostream& operator<<(std::ostream& os, const AllocStats& s)
+{
+    return os << s.allocations << " allocs, " << s.deallocations << " frees, "
+              << s.bytes << " bytes";
+}
+
+// A named place in the code allocations are charged to. Sites form an
+// intrusive list so that registering one never allocates.
+struct AllocSite {
+    explicit AllocSite(const char* siteName) noexcept;
+
+    const char* name;
+    std::atomic<std::size_t> allocations { 0 };
+    std::atomic<std::size_t> bytes { 0 };
+    AllocSite* next { nullptr };
+};
+
+namespace detail {
+
+struct Totals {
+    std::atomic<std::size_t> allocations { 0 };
+    std::atomic<std::size_t> deallocations { 0 };
+    std::atomic<std::size_t> bytes { 0 };
+};
+
+// Plain function-local statics: constant-initialized, so they're usable
+// from operator new even before main() starts.
+inline Totals& totals() noexcept
+{
+    static Totals t;
+    return t;
+}
+
+inline std::atomic<AllocSite*>& sites() noexcept
+{
+    static std::atomic<AllocSite*> head { nullptr };
+    return head;
+}
+
+inline AllocSite*& currentSite() noexcept
+{
+    static thread_local AllocSite* site = nullptr;
+    return site;
+}
+
+inline void* allocate(std::size_t n) noexcept
+{
+    auto& t = totals();
+    t.allocations.fetch_add(1, std::memory_order_relaxed);
+    t.bytes.fetch_add(n, std::memory_order_relaxed);
+    if (auto site = currentSite()) {
+        site->allocations.fetch_add(1, std::memory_order_relaxed);
+        site->bytes.fetch_add(n, std::memory_order_relaxed);
+    }
+    return std::malloc(n ? n : 1);
+}
+
+// Once inlined into code that called operator new, GCC sees malloc'd memory
+// handed to free as mismatched; here it isn't, both are replaced below.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+inline void deallocate(void* p) noexcept
+{
+    if (!p)
+        return;
+    totals().deallocations.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+} // namespace detail
+
+inline AllocSite::AllocSite(const char* siteName) noexcept
+    : name(siteName)
+{
+    auto& head = detail::sites();
+    next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(next, this))
+        ;
+}
+
+inline AllocStats allocStats() noexcept
+{
+    auto& t = detail::totals();
+    return { t.allocations.load(std::memory_order_relaxed),
+             t.deallocations.load(std::memory_order_relaxed),
+             t.bytes.load(std::memory_order_relaxed) };
+}
+
+// What was allocated between construction and delta().
+class AllocScope {
+public:
+    AllocScope() noexcept
+        : start(allocStats())
+    {}
+    AllocStats delta() const noexcept { return allocStats() - start; }
+private:
+    AllocStats start;
+};
+
+// Charges this thread's allocations to site while alive. Scopes nest; the
+// innermost one wins.
+class AllocSiteScope {
+public:
+    explicit AllocSiteScope(AllocSite& site) noexcept
+        : previous(detail::currentSite())
+    {
+        detail::currentSite() = &site;
+    }
+    ~AllocSiteScope() { detail::currentSite() = previous; }
+
+    AllocSiteScope(const AllocSiteScope&) = delete;
+    AllocSiteScope& operator=(const AllocSiteScope&) = delete;
+private:
+    AllocSite* previous;
+};
+
+inline void dumpAllocSites(std::ostream& os)
+{
+    for (auto site = detail::sites().load(); site; site = site->next) {
+        os << std::setw(8) << site->allocations.load() << " allocs "
+           << std::setw(10) << site->bytes.load() << " bytes  " << site->name << '\n';
+    }
+}
+
+} // namespace instrument
+
+#define ALLOC_COUNTER_CAT2(a, b) a##b
+#define ALLOC_COUNTER_CAT(a, b) ALLOC_COUNTER_CAT2(a, b)
+
+// ALLOC_SITE("name"); charges everything allocated from here to the end of
+// the enclosing block to a site called name. ALLOC_SITE(__PRETTY_FUNCTION__)
+// names the site after the function, template arguments included; each
+// instantiation of a template gets its own site.
+#define ALLOC_SITE(siteName)                                                         \
+    static instrument::AllocSite ALLOC_COUNTER_CAT(allocSite_, __LINE__)(siteName); \
+    instrument::AllocSiteScope ALLOC_COUNTER_CAT(allocSiteScope_, __LINE__)(         \
+        ALLOC_COUNTER_CAT(allocSite_, __LINE__))
+
+
+void* operator new(std::size_t n)
+{
+    if (auto p = instrument::detail::allocate(n))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t n)
+{
+    if (auto p = instrument::detail::allocate(n))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+    return instrument::detail::allocate(n);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+    return instrument::detail::allocate(n);
+}
+
+void operator delete(void* p) noexcept { instrument::detail::deallocate(p); }
+void operator delete[](void* p) noexcept { instrument::detail::deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { instrument::detail::deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { instrument::detail::deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { instrument::detail::deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { instrument::detail::deallocate(p); }
+
+#endif // __ALLOC_COUNTER__H__
@@ -0,0 +1,319 @@
+#ifndef __BENCH__H__
+#define __BENCH__H__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// A small microbenchmark harness shared by the item*/bench.cpp programs.
+//
+// Every benchmark is run a few times untimed (warmup) and then for a number
+// of timed repetitions. The summary (mean, standard deviation, min, median,
+// max, all in nanoseconds per operation) goes to stdout as a table, and, with
+// --json=<file>, to a JSON file the top-level 'make bench' collects, so results
+// can be diffed between commits.
+//
+// Command line, shared by all bench programs:
+//   --reps=N       timed repetitions per benchmark (default 10)
+//   --warmup=N     untimed repetitions per benchmark (default 2)
+//   --filter=TEXT  only run benchmarks whose name contains TEXT
+//   --json=FILE    also write the results to FILE
+namespace bench {
+
+// Keeps the compiler from optimizing away a value that's computed but never
+// used. It claims to read v and to clobber memory, and does nothing.
+template<typename T>
+inline void doNotOptimize(const T& v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&v) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &v;
+#endif
+}
+
+struct Stats {
+    double mean { 0 };
+    double stddev { 0 };
+    double min { 0 };
+    double median { 0 };
+    double max { 0 };
+};
+
+// nsPerOp holds one sample per timed repetition.
+inline Stats summarize(std::vector<double> nsPerOp)
+{
+    Stats s;
+    if (nsPerOp.empty())
+        return s;
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    auto n = nsPerOp.size();
+    double sum = 0;
+    for (auto v : nsPerOp)
+        sum += v;
+    s.mean = sum / n;
+    double sq = 0;
+    for (auto v : nsPerOp)
+        sq += (v - s.mean) * (v - s.mean);
+    s.stddev = n > 1 ? std::sqrt(sq / (n - 1)) : 0.0;
+    s.min = nsPerOp.front();
+    s.max = nsPerOp.back();
+    s.median = n % 2 ? nsPerOp[n / 2] : (nsPerOp[n / 2 - 1] + nsPerOp[n / 2]) / 2;
+    return s;
+}
+
+struct Result {
+    std::string name;
+    std::size_t opsPerRep { 0 };
+    int repetitions { 0 };
+    Stats nsPerOp;
+    // Extra numbers a benchmark wants recorded next to its timings,
+    // e.g. allocation counts. Written to JSON as "counters".
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+struct Options {
+    int warmup { 2 };
+    int repetitions { 10 };
+    // run() sizes its batches so one repetition takes at least this long.
+    std::chrono::nanoseconds minRepTime { std::chrono::milliseconds(10) };
+    std::string filter;
+    std::string jsonPath;
+};
+
+inline std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (auto c : s) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                std::ostringstream os;
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c);
+                out += os.str();
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+class Runner {
+public:
+    Runner(std::string suiteName, int argc, char** argv)
+        : suite(std::move(suiteName))
+    {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg(argv[i]);
+            if (!parseArg(arg, "--reps=", opts.repetitions) &&
+                !parseArg(arg, "--warmup=", opts.warmup) &&
+                !parseArg(arg, "--filter=", opts.filter) &&
+                !parseArg(arg, "--json=", opts.jsonPath)) {
+                std::cerr << "unknown argument: " << arg << '\n';
+                std::exit(2);
+            }
+        }
+        if (opts.repetitions < 1)
+            opts.repetitions = 1;
+    }
+
+    Runner(const Runner&) = delete;
+    Runner& operator=(const Runner&) = delete;
+
+    const Options& options() const noexcept { return opts; }
+
+    bool enabled(const std::string& name) const
+    {
+        return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+    }
+
+    // f performs one operation. It's called in batches, sized during warmup
+    // so that a batch takes at least minRepTime; each batch is one repetition.
+    template<typename F>
+    Result* run(const std::string& name, F&& f)
+    {
+        if (!enabled(name))
+            return nullptr;
+        std::size_t batch = 1;
+        for (;;) {
+            auto ns = timeOnce([&] {
+                for (std::size_t i = 0; i < batch; ++i)
+                    f();
+            });
+            if (ns >= opts.minRepTime.count() || batch >= (std::size_t(1) << 30))
+                break;
+            batch *= 2;
+        }
+        return measure(name, batch, [] {}, [&] {
+            for (std::size_t i = 0; i < batch; ++i)
+                f();
+        });
+    }
+
+    // f performs opsPerCall operations itself and each call is one
+    // repetition. setup runs untimed before every call, for benchmarks that
+    // consume or grow their state.
+    template<typename Setup, typename F>
+    Result* runBatch(const std::string& name, std::size_t opsPerCall, Setup&& setup, F&& f)
+    {
+        if (!enabled(name))
+            return nullptr;
+        return measure(name, opsPerCall, setup, f);
+    }
+
+    template<typename F>
+    Result* runBatch(const std::string& name, std::size_t opsPerCall, F&& f)
+    {
+        return runBatch(name, opsPerCall, [] {}, std::forward<F>(f));
+    }
+
+    // Writes the JSON file if one was asked for. Returns main's exit code.
+    int finish() const
+    {
+        if (opts.jsonPath.empty())
+            return 0;
+        std::ofstream out(opts.jsonPath);
+        if (!out) {
+            std::cerr << "can't write " << opts.jsonPath << '\n';
+            return 1;
+        }
+        writeJson(out);
+        return out ? 0 : 1;
+    }
+
+    void writeJson(std::ostream& out) const
+    {
+        out << std::setprecision(17);
+        out << "{\n  \"suite\": \"" << jsonEscape(suite) << "\",\n"
+            << "  \"warmup\": " << opts.warmup << ",\n"
+            << "  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            out << (i ? ",\n" : "\n")
+                << "    {\"name\": \"" << jsonEscape(r.name) << "\", "
+                << "\"ops_per_rep\": " << r.opsPerRep << ", "
+                << "\"repetitions\": " << r.repetitions << ", "
+                << "\"ns_per_op\": {\"mean\": " << r.nsPerOp.mean
+                << ", \"stddev\": " << r.nsPerOp.stddev
+                << ", \"min\": " << r.nsPerOp.min
+                << ", \"median\": " << r.nsPerOp.median
+                << ", \"max\": " << r.nsPerOp.max << "}";
+            if (!r.counters.empty()) {
+                out << ", \"counters\": {";
+                for (std::size_t c = 0; c < r.counters.size(); ++c)
+                    out << (c ? ", " : "") << "\"" << jsonEscape(r.counters[c].first)
+                        << "\": " << r.counters[c].second;
+                out << "}";
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // Attaches a named number to a result, e.g. runner.counter(r, "allocs", n).
+    void counter(Result* r, const std::string& key, double value)
+    {
+        if (r) {
+            r->counters.emplace_back(key, value);
+            // formatted on its own stream, so it doesn't depend on (or
+            // change) what std::cout was left set to
+            std::ostringstream text;
+            if (std::fabs(value) >= 1e6)
+                text << std::fixed << std::setprecision(0);   // not 3.15162e+07
+            text << value;
+            std::cout << "    " << key << ": " << text.str() << '\n';
+        }
+    }
+
+private:
+    template<typename F>
+    static double timeOnce(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count();
+    }
+
+    template<typename Setup, typename F>
+    Result* measure(const std::string& name, std::size_t ops, Setup&& setup, F&& f)
+    {
+        for (int i = 0; i < opts.warmup; ++i) {
+            setup();
+            f();
+        }
+        std::vector<double> samples;
+        samples.reserve(opts.repetitions);
+        for (int i = 0; i < opts.repetitions; ++i) {
+            setup();
+            samples.push_back(timeOnce(f) / ops);
+        }
+        results.emplace_back();
+        auto& r = results.back();
+        r.name = name;
+        r.opsPerRep = ops;
+        r.repetitions = opts.repetitions;
+        r.nsPerOp = summarize(std::move(samples));
+        print(r);
+        return &r;
+    }
+
+    void print(const Result& r) const
+    {
+        std::ios_base::fmtflags flags(std::cout.flags());
+        auto precision = std::cout.precision();
+        std::cout << std::left << std::setw(48) << r.name << std::right << std::fixed
+                  << std::setprecision(2)
+                  << " median " << std::setw(12) << r.nsPerOp.median << " ns/op"
+                  << "  mean " << std::setw(12) << r.nsPerOp.mean
+                  << " +- " << std::setw(10) << r.nsPerOp.stddev
+                  << "  min " << std::setw(12) << r.nsPerOp.min << '\n';
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+
+    static bool parseArg(const std::string& arg, const char* prefix, int& out)
+    {
+        std::string value;
+        if (!parseArg(arg, prefix, value))
+            return false;
+        out = std::atoi(value.c_str());
+        return true;
+    }
+
+    static bool parseArg(const std::string& arg, const char* prefix, std::string& out)
+    {
+        auto len = std::strlen(prefix);
+        if (arg.compare(0, len, prefix) != 0)
+            return false;
+        out = arg.substr(len);
+        return true;
+    }
+
+    std::string suite;
+    Options opts;
+    // a deque, so the Result pointers handed out stay valid as more are added
+    std::deque<Result> results;
+};
+
+} // namespace bench
+
+#endif // __BENCH__H__
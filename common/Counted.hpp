@@ -0,0 +1,135 @@
+#ifndef __COUNTED__H__
+#define __COUNTED__H__
+
+#include <cstddef>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+
+// Counted<T> holds a T and tallies how it's constructed, assigned and
+// destroyed, per T. It's a drop-in stand-in for T in the value-category
+// demos: std::vector<Counted<std::string>> behaves like a vector of strings,
+// and afterwards Counted<std::string>::stats() says how many copies and moves
+// each push_back or sink parameter really cost.
+namespace instrument {
+
+struct LifetimeStats {
+    std::size_t valueConstructs { 0 };  // from T's own constructor arguments
+    std::size_t copyConstructs { 0 };
+    std::size_t moveConstructs { 0 };
+    std::size_t copyAssigns { 0 };
+    std::size_t moveAssigns { 0 };
+    std::size_t destructs { 0 };
+
+    std::size_t copies() const noexcept { return copyConstructs + copyAssigns; }
+    std::size_t moves() const noexcept { return moveConstructs + moveAssigns; }
+};
+
+inline LifetimeStats operator-(const LifetimeStats& lhs, const LifetimeStats& rhs) noexcept
+{
+    return { lhs.valueConstructs - rhs.valueConstructs,
+             lhs.copyConstructs - rhs.copyConstructs,
+             lhs.moveConstructs - rhs.moveConstructs,
+             lhs.copyAssigns - rhs.copyAssigns,
+             lhs.moveAssigns - rhs.moveAssigns,
+             lhs.destructs - rhs.destructs };
+}
+
+inline std::ostream& operator<<(std::ostream& os, const LifetimeStats& s)
+{
+    return os << s.valueConstructs << " constructs, "
+              << s.copyConstructs << " copy ctors, " << s.moveConstructs << " move ctors, "
+              << s.copyAssigns << " copy assigns, " << s.moveAssigns << " move assigns, "
+              << s.destructs << " dtors";
+}
+
+namespace detail {
+
+// true if Ts is a single argument whose decayed type is C
+template<typename C, typename... Ts>
+struct IsSelf : std::false_type {};
+
+template<typename C, typename U>
+struct IsSelf<C, U> : std::is_same<C, std::decay_t<U>> {};
+
+} // namespace detail
+
+template<typename T>
+class Counted {
+public:
+    // Not explicit, so a Counted<std::string> can be passed "xyzzy" just
+    // like a std::string. The enable_if keeps this template from hijacking
+    // copies of non-const Counted lvalues (Item 26).
+    template<typename... Ts,
+             typename = std::enable_if_t<std::is_constructible<T, Ts&&...>::value &&
+                                         !detail::IsSelf<Counted, Ts...>::value>>
+    Counted(Ts&&... params)
+        : value(std::forward<Ts>(params)...)
+    {
+        ++stats().valueConstructs;
+    }
+
+    Counted(const Counted& rhs)
+        : value(rhs.value)
+    {
+        ++stats().copyConstructs;
+    }
+    Counted(Counted&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : value(std::move(rhs.value))
+    {
+        ++stats().moveConstructs;
+    }
+    Counted& operator=(const Counted& rhs)
+    {
+        value = rhs.value;
+        ++stats().copyAssigns;
+        return *this;
+    }
+    Counted& operator=(Counted&& rhs) noexcept(std::is_nothrow_move_assignable<T>::value)
+    {
+        value = std::move(rhs.value);
+        ++stats().moveAssigns;
+        return *this;
+    }
+    ~Counted()
+    {
+        ++stats().destructs;
+    }
+
+    T& get() & noexcept { return value; }
+    const T& get() const & noexcept { return value; }
+    T&& get() && noexcept { return std::move(value); }
+
+    // Not atomic: the demos that use it are single threaded.
+    static LifetimeStats& stats() noexcept
+    {
+        static LifetimeStats s;
+        return s;
+    }
+
+private:
+    T value;
+};
+
+template<typename T>
+std::ostream& operator<<(std::ostream& os, const Counted<T>& c)
+{
+    return os << c.get();
+}
+
+// What happened to Counted<T>s between construction and delta().
+template<typename T>
+class LifetimeScope {
+public:
+    LifetimeScope() noexcept
+        : start(Counted<T>::stats())
+    {}
+    LifetimeStats delta() const noexcept { return Counted<T>::stats() - start; }
+private:
+    LifetimeStats start;
+};
+
+} // namespace instrument
+
+#endif // __COUNTED__H__
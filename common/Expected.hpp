@@ -0,0 +1,265 @@
+#ifndef __EXPECTED__H__
+#define __EXPECTED__H__
+
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+
+// Expected<T, E> holds either a T or an error E, like C++23's std::expected.
+// It's an error channel without exceptions: a failing function returns its
+// error, and the caller checks it, or chains the next step with and_then /
+// map, which skip straight past an error. Nothing unwinds, nothing is thrown
+// across a future and rethrown by get(): an Expected travels through
+// std::future<Expected<T, E>> like any other value.
+//
+//   Expected<int> parse(const std::string& s);
+//   auto r = parse(s).map([](int v) { return v * 2; })
+//                    .and_then(validate)         // returns Expected<int>
+//                    .value_or(0);
+//
+// E defaults to std::error_code: two words, no allocation. value() on an
+// error throws BadExpectedAccess<E>, for callers that do want an exception.
+// T and E must not be references or void.
+template<typename E>
+class Unexpected {
+public:
+    explicit Unexpected(E e) : err(std::move(e)) {}
+    const E& error() const & noexcept { return err; }
+    E&& error() && noexcept { return std::move(err); }
+private:
+    E err;
+};
+
+template<typename E>
+Unexpected<std::decay_t<E>> makeUnexpected(E&& e)
+{
+    return Unexpected<std::decay_t<E>>(std::forward<E>(e));
+}
+
+// For Expected<T, std::error_code>: makeUnexpected(std::errc::invalid_argument).
+inline Unexpected<std::error_code> makeUnexpected(std::errc e)
+{
+    return Unexpected<std::error_code>(std::make_error_code(e));
+}
+
+template<typename E>
+class BadExpectedAccess : public std::logic_error {
+public:
+    explicit BadExpectedAccess(E e)
+        : std::logic_error("Expected::value() called on an error"), err(std::move(e))
+    {}
+    const E& error() const noexcept { return err; }
+private:
+    E err;
+};
+
+template<typename T, typename E = std::error_code>
+class Expected;
+
+namespace detail {
+
+template<typename X>
+struct IsExpected : std::false_type {};
+
+template<typename T, typename E>
+struct IsExpected<Expected<T, E>> : std::true_type {};
+
+} // namespace detail
+
+template<typename T, typename E>
+class Expected {
+    static_assert(!std::is_reference<T>::value && !std::is_void<T>::value &&
+                  !std::is_reference<E>::value && !std::is_void<E>::value,
+                  "Expected holds objects");
+public:
+    using value_type = T;
+    using error_type = E;
+
+    // Not explicit, so a function returning Expected<T> can return a T.
+    template<typename U = T,
+             typename = std::enable_if_t<std::is_constructible<T, U&&>::value &&
+                                         !std::is_same<std::decay_t<U>, Expected>::value>>
+    Expected(U&& v) : has(true)
+    {
+        ::new (&storage) T(std::forward<U>(v));
+    }
+
+    template<typename G>
+    Expected(Unexpected<G> u) : has(false)
+    {
+        ::new (&storage) E(std::move(u).error());
+    }
+
+    Expected(const Expected& rhs) : has(rhs.has)
+    {
+        if (has)
+            ::new (&storage) T(*rhs.val());
+        else
+            ::new (&storage) E(*rhs.err());
+    }
+
+    Expected(Expected&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value &&
+                                      std::is_nothrow_move_constructible<E>::value)
+        : has(rhs.has)
+    {
+        if (has)
+            ::new (&storage) T(std::move(*rhs.val()));
+        else
+            ::new (&storage) E(std::move(*rhs.err()));
+    }
+
+    // Destroy, then move-construct from the copy, so assignment between a
+    // value and an error works. A move that threw halfway would leave no
+    // object behind for the destructor, hence the static_assert; it's only
+    // checked where an Expected is assigned.
+    Expected& operator=(Expected rhs) noexcept
+    {
+        static_assert(std::is_nothrow_move_constructible<T>::value &&
+                      std::is_nothrow_move_constructible<E>::value,
+                      "assigning an Expected needs T and E with nothrow move constructors");
+        destroy();
+        has = rhs.has;
+        if (has)
+            ::new (&storage) T(std::move(*rhs.val()));
+        else
+            ::new (&storage) E(std::move(*rhs.err()));
+        return *this;
+    }
+
+    ~Expected() { destroy(); }
+
+    bool has_value() const noexcept { return has; }
+    explicit operator bool() const noexcept { return has; }
+
+    T& value() &
+    {
+        check();
+        return *val();
+    }
+    const T& value() const &
+    {
+        check();
+        return *val();
+    }
+    T&& value() &&
+    {
+        check();
+        return std::move(*val());
+    }
+
+    // Unchecked, like std::optional's operator*.
+    T& operator*() & noexcept { return *val(); }
+    const T& operator*() const & noexcept { return *val(); }
+    T&& operator*() && noexcept { return std::move(*val()); }
+    T* operator->() noexcept { return val(); }
+    const T* operator->() const noexcept { return val(); }
+
+    const E& error() const & noexcept { return *err(); }
+    E&& error() && noexcept { return std::move(*err()); }
+
+    template<typename U>
+    T value_or(U&& fallback) const &
+    {
+        return has ? *val() : static_cast<T>(std::forward<U>(fallback));
+    }
+    template<typename U>
+    T value_or(U&& fallback) &&
+    {
+        return has ? std::move(*val()) : static_cast<T>(std::forward<U>(fallback));
+    }
+
+    // f(T) returns Expected<U, E>; an error is passed along untouched.
+    template<typename F>
+    auto and_then(F&& f) const &
+    {
+        using R = std::decay_t<decltype(std::forward<F>(f)(std::declval<const T&>()))>;
+        static_assert(detail::IsExpected<R>::value, "and_then's function must return an Expected");
+        return has ? std::forward<F>(f)(*val()) : R(Unexpected<E>(*err()));
+    }
+    template<typename F>
+    auto and_then(F&& f) &&
+    {
+        using R = std::decay_t<decltype(std::forward<F>(f)(std::declval<T&&>()))>;
+        static_assert(detail::IsExpected<R>::value, "and_then's function must return an Expected");
+        return has ? std::forward<F>(f)(std::move(*val())) : R(Unexpected<E>(std::move(*err())));
+    }
+
+    // f(T) returns a plain U; the result is Expected<U, E>.
+    template<typename F>
+    auto map(F&& f) const &
+    {
+        using U = std::decay_t<decltype(std::forward<F>(f)(std::declval<const T&>()))>;
+        using R = Expected<U, E>;
+        return has ? R(std::forward<F>(f)(*val())) : R(Unexpected<E>(*err()));
+    }
+    template<typename F>
+    auto map(F&& f) &&
+    {
+        using U = std::decay_t<decltype(std::forward<F>(f)(std::declval<T&&>()))>;
+        using R = Expected<U, E>;
+        return has ? R(std::forward<F>(f)(std::move(*val())))
+                   : R(Unexpected<E>(std::move(*err())));
+    }
+
+    // f(E) returns Expected<T, G>: a chance to recover, or to translate the
+    // error. A value is passed along untouched.
+    template<typename F>
+    auto or_else(F&& f) const &
+    {
+        using R = std::decay_t<decltype(std::forward<F>(f)(std::declval<const E&>()))>;
+        static_assert(detail::IsExpected<R>::value, "or_else's function must return an Expected");
+        return has ? R(*val()) : std::forward<F>(f)(*err());
+    }
+
+    // f(E) returns a plain G; the result is Expected<T, G>.
+    template<typename F>
+    auto map_error(F&& f) const &
+    {
+        using G = std::decay_t<decltype(std::forward<F>(f)(std::declval<const E&>()))>;
+        using R = Expected<T, G>;
+        return has ? R(*val()) : R(Unexpected<G>(std::forward<F>(f)(*err())));
+    }
+
+private:
+    void check() const
+    {
+        if (!has)
+            throw BadExpectedAccess<E>(*err());
+    }
+
+    void destroy() noexcept
+    {
+        if (has)
+            val()->~T();
+        else
+            err()->~E();
+    }
+
+    T* val() noexcept { return reinterpret_cast<T*>(&storage); }
+    const T* val() const noexcept { return reinterpret_cast<const T*>(&storage); }
+    E* err() noexcept { return reinterpret_cast<E*>(&storage); }
+    const E* err() const noexcept { return reinterpret_cast<const E*>(&storage); }
+
+    std::aligned_union_t<0, T, E> storage;
+    bool has;
+};
+
+// Runs f(args...) and turns an exception it throws into an error, for
+// wrapping code that still throws: Expected<R, std::exception_ptr>.
+template<typename F, typename... Args>
+auto tryCall(F&& f, Args&&... args)
+    -> Expected<std::decay_t<decltype(std::forward<F>(f)(std::forward<Args>(args)...))>,
+                std::exception_ptr>
+{
+    try {
+        return std::forward<F>(f)(std::forward<Args>(args)...);
+    } catch (...) {
+        return makeUnexpected(std::current_exception());
+    }
+}
+
+#endif // __EXPECTED__H__
@@ -0,0 +1,205 @@
+#ifndef __PERF_COUNTERS__H__
+#define __PERF_COUNTERS__H__
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+// Hardware and software performance counters around regions of code, through
+// Linux perf_event_open:
+//
+//   instrument::PerfCounters perf;
+//   auto r = runner.runBatch("scan", n, [&] {
+//       auto region = perf.region();
+//       scan();
+//   });
+//   instrument::reportPerf(runner, r, perf, n);   // cycles/op, IPC, ...
+//
+// Counted: cycles, instructions, cache misses and branch misses from the
+// CPU, task clock, page faults and context switches from the kernel, user
+// space only, for the thread that made the PerfCounters (threads it starts
+// aren't counted). Each counter is opened on its own, so whatever the
+// machine allows is kept: in VMs without a virtual PMU, or with
+// kernel.perf_event_paranoid above 2, the hardware ones fail to open and
+// only the software ones are reported; elsewhere than Linux, none are.
+// unavailable() says why. When the kernel has to multiplex counters, values
+// are scaled up by enabled/running time.
+//
+// Regions add up: totals() holds the sum over all of them, and reportPerf
+// divides by regions() * opsPerRegion.
+namespace instrument {
+
+enum class PerfEvent { cycles, instructions, cacheMisses, branchMisses,
+                       taskClock, pageFaults, contextSwitches };
+
+constexpr std::size_t perfEventCount = 7;
+
+inline const char* perfEventName(PerfEvent e)
+{
+    static const char* const names[perfEventCount] = {
+        "cycles", "instructions", "cache misses", "branch misses",
+        "task clock ns", "page faults", "context switches",
+    };
+    return names[static_cast<std::size_t>(e)];
+}
+
+struct PerfSample {
+    std::array<double, perfEventCount> values {};
+    double operator[](PerfEvent e) const { return values[static_cast<std::size_t>(e)]; }
+};
+
+class PerfCounters {
+public:
+    PerfCounters()
+    {
+        fds.fill(-1);
+#if defined(__linux__)
+        static const std::pair<std::uint32_t, std::uint64_t> configs[perfEventCount] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+        };
+        for (std::size_t i = 0; i < perfEventCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = configs[i].first;
+            attr.config = configs[i].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds[i] < 0 && why.empty())
+                why = std::string(perfEventName(static_cast<PerfEvent>(i))) + ": " +
+                      std::strerror(errno);
+        }
+#else
+        why = "perf_event_open is Linux only";
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (auto fd : fds)
+            if (fd >= 0)
+                close(fd);
+#endif
+    }
+
+    bool available(PerfEvent e) const noexcept { return fds[static_cast<std::size_t>(e)] >= 0; }
+
+    // Why the first counter that failed to open did; empty if none failed.
+    const std::string& unavailable() const noexcept { return why; }
+
+    void start()
+    {
+#if defined(__linux__)
+        for (auto fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop()
+    {
+#if defined(__linux__)
+        for (auto fd : fds)
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (std::size_t i = 0; i < perfEventCount; ++i) {
+            if (fds[i] < 0)
+                continue;
+            std::uint64_t buf[3] = {};  // value, time enabled, time running
+            if (read(fds[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0)
+                continue;
+            sum.values[i] += buf[1] == buf[2] ? buf[0] : double(buf[0]) * buf[1] / buf[2];
+        }
+#endif
+        ++count;
+    }
+
+    class Region {
+    public:
+        explicit Region(PerfCounters& counters) : pc(&counters) { pc->start(); }
+        Region(Region&& rhs) noexcept : pc(rhs.pc) { rhs.pc = nullptr; }
+        Region& operator=(Region&&) = delete;
+        ~Region()
+        {
+            if (pc)
+                pc->stop();
+        }
+    private:
+        PerfCounters* pc;
+    };
+
+    Region region() { return Region(*this); }
+
+    const PerfSample& totals() const noexcept { return sum; }
+    std::size_t regions() const noexcept { return count; }
+    void reset() noexcept
+    {
+        sum = PerfSample();
+        count = 0;
+    }
+
+private:
+    std::array<int, perfEventCount> fds;
+    PerfSample sum;
+    std::size_t count { 0 };
+    std::string why;
+};
+
+// Adds "<counter>/op" for every counter that opened, and IPC when both
+// cycles and instructions did, to a bench::Result; then resets perf for
+// the next row. Says once, on stderr, what couldn't be counted.
+template<typename Runner, typename Result>
+void reportPerf(Runner& runner, Result* r, PerfCounters& perf, std::size_t opsPerRegion)
+{
+    static bool told = false;
+    if (!told && !perf.unavailable().empty()) {
+        std::fprintf(stderr, "perf counters: %s; reporting the rest\n", perf.unavailable().c_str());
+        told = true;
+    }
+    if (r && perf.regions() > 0) {
+        auto ops = double(perf.regions()) * opsPerRegion;
+        const auto& t = perf.totals();
+        for (std::size_t i = 0; i < perfEventCount; ++i) {
+            auto e = static_cast<PerfEvent>(i);
+            if (perf.available(e))
+                runner.counter(r, std::string(perfEventName(e)) + "/op", t[e] / ops);
+        }
+        if (perf.available(PerfEvent::cycles) && perf.available(PerfEvent::instructions) &&
+            t[PerfEvent::cycles] > 0)
+            runner.counter(r, "IPC", t[PerfEvent::instructions] / t[PerfEvent::cycles]);
+    }
+    perf.reset();
+}
+
+} // namespace instrument
+
+#endif // __PERF_COUNTERS__H__
@@ -0,0 +1,550 @@
+#ifndef __TASK__H__
+#define __TASK__H__
+
+#if !defined(__cpp_impl_coroutine)
+#error "Task.hpp needs C++20 coroutines; compile with -std=c++20"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// Coroutine tasks: the task-based style of Item 35 without a thread per
+// task. std::async (with launch::async) gives each task its own thread for
+// its whole life, sleeping or blocked included; a Task<T> is a coroutine
+// frame, and an Executor runs any number of them on a few worker threads,
+// suspending them while they wait.
+//
+//   Task<T>        lazy: nothing runs until it's co_awaited. Awaiting it
+//                  returns its co_return value or rethrows its exception,
+//                  the way fut.get() does. Resuming the awaiter when the task
+//                  finishes is a symmetric transfer, so long chains of tasks
+//                  don't grow the stack.
+//   Executor       a fixed pool of workers plus one reactor thread for timers
+//                  and futures. Awaitables:
+//                    co_await ex.schedule();         continue on a worker
+//                    co_await ex.sleepFor(10ms);     timer, no thread blocked
+//                    co_await ex.whenReady(std::move(fut));   std::future<T>
+//   Event          co_await event; suspends until event.set(), like the
+//                  condition variable and flag pattern of Item 39.
+//   whenAll(v)     runs a vector of tasks concurrently, returns all results.
+//   syncWait(t)    blocks the calling thread until t is done (for main).
+//   ex.spawn(t)    fire and forget; t must not throw, as with std::thread.
+//
+// Destroy an Executor only after every task using it has finished.
+namespace coro {
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation { std::noop_coroutine() };
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // Hands control straight to whoever awaited the task.
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            return h.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template<typename T>
+struct Promise : PromiseBase {
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+    T take()
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template<>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void take()
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+// A coroutine that starts at once and frees itself when done. Used to
+// start tasks that nobody awaits.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+template<typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    Task(Task&& rhs) noexcept : h(std::exchange(rhs.h, {})) {}
+    Task& operator=(Task&& rhs) noexcept
+    {
+        std::swap(h, rhs.h);
+        return *this;
+    }
+    ~Task()
+    {
+        if (h)
+            h.destroy();
+    }
+
+    auto operator co_await() noexcept
+    {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> h;
+
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+            {
+                h.promise().continuation = caller;
+                return h;
+            }
+            T await_resume() { return h.promise().take(); }
+        };
+        return Awaiter { h };
+    }
+
+private:
+    friend promise_type;
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : h(handle) {}
+
+    std::coroutine_handle<promise_type> h;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+} // namespace detail
+
+
+class Executor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Executor(unsigned threads = std::thread::hardware_concurrency())
+    {
+        threads = std::max(threads, 1u);
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([this] { work(); });
+        reactor = std::thread([this] { react(); });
+    }
+
+    ~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> g(reactorMutex);
+            reactorStopping = true;
+        }
+        reactorCv.notify_one();
+        reactor.join();
+        {
+            std::lock_guard<std::mutex> g(queueMutex);
+            stopping = true;
+        }
+        queueCv.notify_all();
+        for (auto& t : workers)
+            t.join();
+    }
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // Queues h to be resumed on a worker.
+    void post(std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> g(queueMutex);
+            queue.push_back(h);
+        }
+        queueCv.notify_one();
+    }
+
+    auto schedule() noexcept
+    {
+        struct Awaiter {
+            Executor& ex;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { ex.post(h); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter { *this };
+    }
+
+    // Resumes on a worker once d has passed.
+    template<typename Rep, typename Period>
+    auto sleepFor(std::chrono::duration<Rep, Period> d)
+    {
+        struct Awaiter {
+            Executor& ex;
+            Clock::time_point when;
+            bool await_ready() noexcept { return when <= Clock::now(); }
+            void await_suspend(std::coroutine_handle<> h) { ex.addTimer(when, h); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter { *this, Clock::now() + std::chrono::duration_cast<Clock::duration>(d) };
+    }
+
+    // Resumes on a worker once fut is ready, with fut.get()'s value or
+    // exception. std::future can't call back, so the reactor polls pending
+    // futures every futurePoll. A deferred future is run right away, by get().
+    template<typename T>
+    auto whenReady(std::future<T> fut)
+    {
+        struct Awaiter {
+            Executor& ex;
+            std::future<T> fut;
+            bool await_ready()
+            {
+                return fut.wait_for(std::chrono::seconds(0)) != std::future_status::timeout;
+            }
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                ex.addFuture([this] {
+                    return fut.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                }, h);
+            }
+            T await_resume() { return fut.get(); }
+        };
+        return Awaiter { *this, std::move(fut) };
+    }
+
+    void spawn(Task<void> task)
+    {
+        [](Executor& ex, Task<void> t) -> detail::Detached {
+            co_await ex.schedule();
+            co_await t;
+        }(*this, std::move(task));
+    }
+
+    static constexpr std::chrono::microseconds futurePoll { 100 };
+
+private:
+    void work()
+    {
+        for (;;) {
+            std::coroutine_handle<> h;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                h = queue.front();
+                queue.pop_front();
+            }
+            h.resume();
+        }
+    }
+
+    struct Timer {
+        Clock::time_point when;
+        std::coroutine_handle<> h;
+        bool operator>(const Timer& rhs) const noexcept { return when > rhs.when; }
+    };
+
+    struct PendingFuture {
+        std::function<bool()> ready;
+        std::coroutine_handle<> h;
+    };
+
+    void addTimer(Clock::time_point when, std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> g(reactorMutex);
+            timers.push({ when, h });
+        }
+        reactorCv.notify_one();
+    }
+
+    void addFuture(std::function<bool()> ready, std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> g(reactorMutex);
+            futures.push_back({ std::move(ready), h });
+        }
+        reactorCv.notify_one();
+    }
+
+    // Moves due timers and ready futures to the worker queue, then sleeps
+    // until the next timer, the next future poll, or new work.
+    void react()
+    {
+        std::unique_lock<std::mutex> lock(reactorMutex);
+        while (!reactorStopping) {
+            auto now = Clock::now();
+            while (!timers.empty() && timers.top().when <= now) {
+                post(timers.top().h);
+                timers.pop();
+            }
+            auto ready = std::stable_partition(futures.begin(), futures.end(),
+                                               [](const PendingFuture& f) { return !f.ready(); });
+            for (auto it = ready; it != futures.end(); ++it)
+                post(it->h);
+            futures.erase(ready, futures.end());
+
+            auto deadline = Clock::time_point::max();
+            if (!timers.empty())
+                deadline = timers.top().when;
+            if (!futures.empty())
+                deadline = std::min(deadline, now + futurePoll);
+            if (deadline == Clock::time_point::max())
+                reactorCv.wait(lock);
+            else
+                reactorCv.wait_until(lock, deadline);
+        }
+    }
+
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::deque<std::coroutine_handle<>> queue;
+    bool stopping { false };
+    std::vector<std::thread> workers;
+
+    std::mutex reactorMutex;
+    std::condition_variable reactorCv;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::vector<PendingFuture> futures;
+    bool reactorStopping { false };
+    std::thread reactor;
+};
+
+
+// Manual-reset event. Awaiters that find it unset suspend and are resumed
+// on the executor when it's set; later awaiters don't suspend at all.
+class Event {
+public:
+    explicit Event(Executor& executor) : ex(executor) {}
+    Event(const Event&) = delete;
+    Event& operator=(const Event&) = delete;
+
+    void set()
+    {
+        std::vector<std::coroutine_handle<>> toResume;
+        {
+            std::lock_guard<std::mutex> g(m);
+            flag = true;
+            toResume.swap(waiters);
+        }
+        for (auto h : toResume)
+            ex.post(h);
+    }
+
+    bool isSet() const
+    {
+        std::lock_guard<std::mutex> g(m);
+        return flag;
+    }
+
+    auto operator co_await() noexcept
+    {
+        struct Awaiter {
+            Event& e;
+            bool await_ready() { return e.isSet(); }
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                std::lock_guard<std::mutex> g(e.m);
+                if (e.flag)
+                    return false;
+                e.waiters.push_back(h);
+                return true;
+            }
+            void await_resume() noexcept {}
+        };
+        return Awaiter { *this };
+    }
+
+private:
+    Executor& ex;
+    mutable std::mutex m;
+    bool flag { false };
+    std::vector<std::coroutine_handle<>> waiters;
+};
+
+
+namespace detail {
+
+// Counts down the children of a whenAll; the last one to finish resumes the
+// parent. The count starts one higher, for the parent itself, so that the
+// parent can't be resumed before it has suspended.
+struct WhenAllState {
+    explicit WhenAllState(std::size_t children) : remaining(children + 1) {}
+
+    void childDone()
+    {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            parent.resume();
+    }
+
+    void fail(std::exception_ptr e)
+    {
+        std::lock_guard<std::mutex> g(m);
+        if (!error)
+            error = e;
+    }
+
+    std::atomic<std::size_t> remaining;
+    std::coroutine_handle<> parent;
+    std::mutex m;
+    std::exception_ptr error;
+};
+
+template<typename Start>
+struct StartChildren {
+    WhenAllState& state;
+    Start start;
+
+    bool await_ready() noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        state.parent = h;
+        start();
+        // false: every child already finished, carry on without suspending
+        return state.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+    void await_resume() noexcept {}
+};
+
+template<typename Start>
+StartChildren<Start> startChildren(WhenAllState& state, Start start)
+{
+    return { state, std::move(start) };
+}
+
+template<typename T>
+Detached runChild(Task<T> t, WhenAllState& state, std::optional<T>& slot)
+{
+    try {
+        slot.emplace(co_await t);
+    } catch (...) {
+        state.fail(std::current_exception());
+    }
+    state.childDone();
+}
+
+inline Detached runChild(Task<void> t, WhenAllState& state)
+{
+    try {
+        co_await t;
+    } catch (...) {
+        state.fail(std::current_exception());
+    }
+    state.childDone();
+}
+
+template<typename T>
+Detached runSync(Task<T> t, std::promise<T>& result)
+{
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await t;
+            result.set_value();
+        } else {
+            result.set_value(co_await t);
+        }
+    } catch (...) {
+        result.set_exception(std::current_exception());
+    }
+}
+
+} // namespace detail
+
+// Starts every task, and finishes when all have. If any threw, the first
+// exception is rethrown (after all have finished).
+template<typename T>
+Task<std::vector<T>> whenAll(std::vector<Task<T>> tasks)
+{
+    std::vector<std::optional<T>> slots(tasks.size());
+    detail::WhenAllState state(tasks.size());
+    co_await detail::startChildren(state, [&] {
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+            detail::runChild(std::move(tasks[i]), state, slots[i]);
+    });
+    if (state.error)
+        std::rethrow_exception(state.error);
+    std::vector<T> results;
+    results.reserve(slots.size());
+    for (auto& s : slots)
+        results.push_back(std::move(*s));
+    co_return results;
+}
+
+inline Task<void> whenAll(std::vector<Task<void>> tasks)
+{
+    detail::WhenAllState state(tasks.size());
+    co_await detail::startChildren(state, [&] {
+        for (auto& t : tasks)
+            detail::runChild(std::move(t), state);
+    });
+    if (state.error)
+        std::rethrow_exception(state.error);
+}
+
+// Runs task to completion, blocking this thread; returns its result or
+// rethrows its exception.
+template<typename T>
+T syncWait(Task<T> task)
+{
+    std::promise<T> result;
+    auto fut = result.get_future();
+    detail::runSync(std::move(task), result);
+    return fut.get();
+}
+
+} // namespace coro
+
+#endif // __TASK__H__
@@ -0,0 +1,268 @@
+#ifndef __TRACE__H__
+#define __TRACE__H__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+
+// A timeline of what each thread did, written as Chrome trace-event JSON:
+// load the file in chrome://tracing or ui.perfetto.dev to see every thread as
+// a row of spans.
+//
+//   TRACE_THREAD_NAME("worker");        // the row's label
+//   {
+//       TRACE_SPAN("parse");            // a span from here to the end of
+//       ...                             // the block
+//   }
+//   instrument::writeTraceFile("trace.json");
+//
+// The macros compile to nothing unless TRACE_ENABLED is defined ('make
+// trace' in an instrumented item does that and writes trace.json), so the
+// primitives can stay instrumented in the normal build at no cost.
+//
+// Each thread appends to its own buffer, so recording takes no lock and
+// shares no cache line with other threads. A span is two steady_clock reads
+// and a 24-byte store: about 90ns on the VM the item38 bench ran on, nearly
+// all of it the clock reads (an instant event, one read, was about 50ns; see
+// the bench's "trace:" rows). Writing the JSON out costs about 1.7us per
+// event. Buffers grow in blocks of 4096 events up to maxTraceEvents per
+// thread; later events are dropped and counted. They outlive their threads,
+// so a thread that has finished still shows up.
+//
+// Span names are kept as pointers: pass string literals, or anything else
+// that outlives the export. A std::string name is copied into the thread's
+// buffer instead, which allocates; once the buffer is full such names aren't
+// kept either, so memory stays capped. Export once the traced threads are
+// done, or at least quiet: a thread appending while the exporter reads is
+// safe, but a thread name set meanwhile is not.
+namespace instrument {
+
+constexpr std::size_t traceBlockEvents = 4096;
+constexpr std::size_t maxTraceEvents = 1 << 20;
+
+struct TraceEvent {
+    const char* name;
+    std::uint64_t start;        // ns on steady_clock
+    std::uint64_t duration;     // ns; instantEvent for a point in time
+};
+
+constexpr std::uint64_t instantEvent = ~std::uint64_t(0);
+
+inline std::uint64_t traceNow() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+namespace detail {
+
+struct TraceBlock {
+    TraceEvent events[traceBlockEvents];
+    std::atomic<TraceBlock*> next { nullptr };
+};
+
+// One per thread that ever recorded something, never freed. Only the owning
+// thread writes; count is published with release, so the exporter, reading
+// with acquire, sees every event below it complete.
+struct TraceBuffer {
+    TraceBlock first;
+    TraceBlock* last { &first };
+    std::atomic<std::size_t> count { 0 };
+    std::size_t dropped { 0 };
+    unsigned tid { 0 };
+    std::string threadName;
+    std::deque<std::string> names;      // copies of std::string span names
+    TraceBuffer* next { nullptr };
+};
+
+inline std::atomic<TraceBuffer*>& traceBuffers() noexcept
+{
+    static std::atomic<TraceBuffer*> head { nullptr };
+    return head;
+}
+
+inline TraceBuffer& threadTraceBuffer()
+{
+    static thread_local TraceBuffer* buffer = [] {
+        static std::atomic<unsigned> nextTid { 1 };
+        auto b = new TraceBuffer;
+        b->tid = nextTid.fetch_add(1, std::memory_order_relaxed);
+        auto& head = traceBuffers();
+        b->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(b->next, b, std::memory_order_release))
+            ;
+        return b;
+    }();
+    return *buffer;
+}
+
+inline void record(const char* name, std::uint64_t start, std::uint64_t duration)
+{
+    auto& b = threadTraceBuffer();
+    auto n = b.count.load(std::memory_order_relaxed);
+    if (n >= maxTraceEvents) {
+        ++b.dropped;
+        return;
+    }
+    auto slot = n % traceBlockEvents;
+    if (slot == 0 && n != 0) {
+        // blocks stay linked after clearThreadTrace(), ready for reuse
+        auto block = b.last->next.load(std::memory_order_relaxed);
+        if (!block) {
+            block = new TraceBlock;
+            b.last->next.store(block, std::memory_order_release);
+        }
+        b.last = block;
+    }
+    b.last->events[slot] = TraceEvent { name, start, duration };
+    b.count.store(n + 1, std::memory_order_release);
+}
+
+inline void writeJsonString(std::ostream& os, const char* s)
+{
+    os << '"';
+    for (; *s; ++s) {
+        auto c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\')
+            os << '\\' << *s;
+        else if (c < 0x20)
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c)
+               << std::dec << std::setfill(' ');
+        else
+            os << *s;
+    }
+    os << '"';
+}
+
+} // namespace detail
+
+// Records a span from construction to destruction on this thread.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* spanName) noexcept
+        : name(spanName), start(traceNow())
+    {}
+    explicit TraceSpan(const std::string& spanName)
+        : name(intern(spanName)), start(traceNow())
+    {}
+    ~TraceSpan() { detail::record(name, start, traceNow() - start); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    static const char* intern(const std::string& s)
+    {
+        auto& b = detail::threadTraceBuffer();
+        // a full buffer drops the event anyway; don't keep its name either
+        if (b.count.load(std::memory_order_relaxed) >= maxTraceEvents)
+            return "";
+        b.names.push_back(s);
+        return b.names.back().c_str();
+    }
+
+    const char* name;
+    std::uint64_t start;
+};
+
+inline void traceInstant(const char* name)
+{
+    detail::record(name, traceNow(), instantEvent);
+}
+
+inline void setTraceThreadName(const std::string& name)
+{
+    detail::threadTraceBuffer().threadName = name;
+}
+
+// Forgets the calling thread's events, keeping its blocks for reuse. Not
+// while an export is running.
+inline void clearThreadTrace() noexcept
+{
+    auto& b = detail::threadTraceBuffer();
+    b.count.store(0, std::memory_order_release);
+    b.last = &b.first;
+    b.dropped = 0;
+    b.names.clear();
+}
+
+// Every thread's events, as {"traceEvents": [...]}: "X" events for spans,
+// "i" for instants, "M" for thread names, timestamps in microseconds.
+// Restores the stream's flags and precision.
+inline void writeTrace(std::ostream& os)
+{
+    std::ios_base::fmtflags flags(os.flags());
+    auto precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "{\"traceEvents\":[";
+    bool firstEvent = true;
+    auto separator = [&os, &firstEvent] {
+        os << (firstEvent ? "\n" : ",\n");
+        firstEvent = false;
+    };
+    for (auto b = detail::traceBuffers().load(std::memory_order_acquire); b; b = b->next) {
+        auto n = b->count.load(std::memory_order_acquire);
+        if (!b->threadName.empty()) {
+            separator();
+            os << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->tid
+               << ",\"args\":{\"name\":";
+            detail::writeJsonString(os, b->threadName.c_str());
+            os << "}}";
+        }
+        if (b->dropped) {
+            separator();
+            os << "{\"ph\":\"M\",\"name\":\"dropped_events\",\"pid\":1,\"tid\":" << b->tid
+               << ",\"args\":{\"count\":" << b->dropped << "}}";
+        }
+        const detail::TraceBlock* block = &b->first;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i != 0 && i % traceBlockEvents == 0)
+                block = block->next.load(std::memory_order_acquire);
+            const auto& e = block->events[i % traceBlockEvents];
+            separator();
+            os << "{\"name\":";
+            detail::writeJsonString(os, e.name);
+            if (e.duration == instantEvent)
+                os << ",\"ph\":\"i\",\"s\":\"t\"";
+            else
+                os << ",\"ph\":\"X\",\"dur\":" << e.duration / 1000.0;
+            os << ",\"ts\":" << e.start / 1000.0 << ",\"pid\":1,\"tid\":" << b->tid << '}';
+        }
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    os.flags(flags);
+    os.precision(precision);
+}
+
+inline bool writeTraceFile(const std::string& path)
+{
+    std::ofstream out(path);
+    writeTrace(out);
+    return static_cast<bool>(out);
+}
+
+} // namespace instrument
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+
+#if defined(TRACE_ENABLED)
+#define TRACE_SPAN(spanName) instrument::TraceSpan TRACE_CAT(traceSpan_, __LINE__)(spanName)
+#define TRACE_INSTANT(eventName) instrument::traceInstant(eventName)
+#define TRACE_THREAD_NAME(threadName) instrument::setTraceThreadName(threadName)
+#define TRACE_WRITE(path) instrument::writeTraceFile(path)
+#else
+#define TRACE_SPAN(spanName) ((void)0)
+#define TRACE_INSTANT(eventName) ((void)0)
+#define TRACE_THREAD_NAME(threadName) ((void)0)
+#define TRACE_WRITE(path) ((void)0)
+#endif
+
+#endif // __TRACE__H__
@@ -0,0 +1,245 @@
+#ifndef __BUFFER__H__
+#define __BUFFER__H__
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+// Widget::data() && hands its vector to the caller by moving it. Buffer makes
+// that the normal way for processing stages to pass data along: a Buffer is a
+// cheap handle to a shared block of doubles, so moving or copying the handle
+// never touches the elements. slice() gives a handle to part of the same block,
+// and when the last handle to a block goes away, the block goes back to the
+// BufferPool it came from instead of to the heap.
+//
+// The counters are what lets a pipeline prove it didn't copy. Only clone() and
+// toVector() ever copy elements, and both count what they copy.
+struct BufferStats {
+    std::atomic<std::size_t> allocations { 0 };   // blocks a pool took from the heap
+    std::atomic<std::size_t> reuses { 0 };        // blocks taken from a pool
+    std::atomic<std::size_t> releases { 0 };      // blocks returned to a pool
+    std::atomic<std::size_t> handleCopies { 0 };  // Buffer copy-constructs/-assigns
+    std::atomic<std::size_t> handleMoves { 0 };   // Buffer move-constructs/-assigns
+    std::atomic<std::size_t> elementCopies { 0 }; // doubles copied by clone()/toVector()
+
+    void reset() noexcept
+    {
+        allocations = 0;
+        reuses = 0;
+        releases = 0;
+        handleCopies = 0;
+        handleMoves = 0;
+        elementCopies = 0;
+    }
+};
+
+inline BufferStats& bufferStats() noexcept
+{
+    static BufferStats stats;
+    return stats;
+}
+
+
+class Buffer;
+
+// A free list of blocks. The pool's state is shared with every block handed
+// out, so a Buffer may outlive the BufferPool object that created it; its block
+// is simply freed then.
+class BufferPool {
+public:
+    explicit BufferPool(std::size_t maxFree = 64)
+        : state(std::make_shared<State>(maxFree))
+    {}
+
+    // A block of n doubles, reused from the free list when one is big enough.
+    // The contents are unspecified, as with new double[n].
+    Buffer acquire(std::size_t n);
+
+    std::size_t freeBlocks() const
+    {
+        std::lock_guard<std::mutex> g(state->m);
+        return state->free.size();
+    }
+
+private:
+    struct State {
+        explicit State(std::size_t maxFree)
+            : maxFree(maxFree)
+        {}
+        std::mutex m;
+        std::size_t maxFree;
+        std::vector<std::unique_ptr<std::vector<double>>> free;
+    };
+
+    std::shared_ptr<State> state;
+};
+
+
+class Buffer {
+public:
+    using value_type = double;
+    using iterator = double*;
+    using const_iterator = const double*;
+
+    Buffer() = default;
+
+    // Takes over v's storage; nothing is copied. The block is freed, not
+    // pooled, when the last handle goes away.
+    explicit Buffer(std::vector<double>&& v)
+        : block(std::make_shared<std::vector<double>>(std::move(v))),
+          first(0), count(block->size())
+    {}
+
+    Buffer(const Buffer& rhs) noexcept
+        : block(rhs.block), first(rhs.first), count(rhs.count), pooled(rhs.pooled)
+    {
+        ++bufferStats().handleCopies;
+    }
+    Buffer(Buffer&& rhs) noexcept
+        : block(std::move(rhs.block)), first(rhs.first), count(rhs.count),
+          pooled(rhs.pooled)
+    {
+        rhs.first = rhs.count = 0;
+        ++bufferStats().handleMoves;
+    }
+    Buffer& operator=(const Buffer& rhs) noexcept
+    {
+        block = rhs.block;
+        first = rhs.first;
+        count = rhs.count;
+        pooled = rhs.pooled;
+        ++bufferStats().handleCopies;
+        return *this;
+    }
+    Buffer& operator=(Buffer&& rhs) noexcept
+    {
+        block = std::move(rhs.block);
+        first = rhs.first;
+        count = rhs.count;
+        pooled = rhs.pooled;
+        rhs.first = rhs.count = 0;
+        ++bufferStats().handleMoves;
+        return *this;
+    }
+
+    std::size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+
+    // true if no other handle (slice or copy) shares this block, i.e. writing
+    // through data() can't be observed by anyone else.
+    bool unique() const noexcept { return block.use_count() == 1; }
+
+    // Identity of the underlying block, for checking that two stages really
+    // saw the same memory.
+    const void* blockId() const noexcept { return block.get(); }
+
+    double* data() noexcept { return block ? block->data() + first : nullptr; }
+    const double* data() const noexcept { return block ? block->data() + first : nullptr; }
+    double& operator[](std::size_t i) noexcept { assert(i < count); return data()[i]; }
+    double operator[](std::size_t i) const noexcept { assert(i < count); return data()[i]; }
+    iterator begin() noexcept { return data(); }
+    iterator end() noexcept { return data() + count; }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator end() const noexcept { return data() + count; }
+
+    // [pos, pos + n) of this buffer, sharing the block. Like
+    // std::string::substr, n is clamped to what's left.
+    Buffer slice(std::size_t pos, std::size_t n = static_cast<std::size_t>(-1)) const &
+    {
+        assert(pos <= count);
+        Buffer result(*this);
+        result.first = first + pos;
+        result.count = std::min(n, count - pos);
+        return result;
+    }
+    Buffer slice(std::size_t pos, std::size_t n = static_cast<std::size_t>(-1)) &&
+    {
+        assert(pos <= count);
+        Buffer result(std::move(*this));
+        result.first += pos;
+        result.count = std::min(n, result.count - pos);
+        return result;
+    }
+
+    // A private copy of the elements in a fresh block. This is the one
+    // explicit way to copy, and it's counted.
+    Buffer clone() const
+    {
+        bufferStats().elementCopies += count;
+        return Buffer(std::vector<double>(begin(), end()));
+    }
+
+    // Back to a plain vector for code that wants one. On an lvalue this always
+    // copies. On an rvalue that is the only handle to a whole block that didn't
+    // come from a pool, the vector is moved out, just like Widget::data() &&.
+    std::vector<double> toVector() const &
+    {
+        bufferStats().elementCopies += count;
+        return std::vector<double>(begin(), end());
+    }
+    std::vector<double> toVector() &&
+    {
+        if (unique() && !pooled && first == 0 && count == block->size()) {
+            std::vector<double> result(std::move(*block));
+            block.reset();
+            first = count = 0;
+            return result;
+        }
+        return static_cast<const Buffer&>(*this).toVector();
+    }
+
+private:
+    friend class BufferPool;
+
+    Buffer(std::shared_ptr<std::vector<double>> b, std::size_t n)
+        : block(std::move(b)), first(0), count(n), pooled(true)
+    {}
+
+    std::shared_ptr<std::vector<double>> block;
+    std::size_t first { 0 };
+    std::size_t count { 0 };
+    bool pooled { false };
+};
+
+
+inline Buffer BufferPool::acquire(std::size_t n)
+{
+    std::unique_ptr<std::vector<double>> v;
+    {
+        std::lock_guard<std::mutex> g(state->m);
+        auto it = std::find_if(state->free.begin(), state->free.end(),
+                               [n](const std::unique_ptr<std::vector<double>>& b) {
+                                   return b->size() >= n;
+                               });
+        if (it != state->free.end()) {
+            v = std::move(*it);
+            state->free.erase(it);
+        }
+    }
+    if (v)
+        ++bufferStats().reuses;
+    else {
+        v = std::make_unique<std::vector<double>>(n);
+        ++bufferStats().allocations;
+    }
+
+    // The deleter holds the pool's state, so the block finds its way back
+    // even after the BufferPool object itself is gone.
+    auto st = state;
+    std::shared_ptr<std::vector<double>> block(v.release(), [st](std::vector<double>* p) {
+        std::unique_ptr<std::vector<double>> owned(p);
+        std::lock_guard<std::mutex> g(st->m);
+        if (st->free.size() < st->maxFree) {
+            st->free.push_back(std::move(owned));
+            ++bufferStats().releases;
+        }
+    });
+    return Buffer(std::move(block), n);
+}
+
+#endif // __BUFFER__H__
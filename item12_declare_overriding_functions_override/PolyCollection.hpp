@@ -0,0 +1,145 @@
+#ifndef __POLY_COLLECTION__H__
+#define __POLY_COLLECTION__H__
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// std::vector<std::unique_ptr<Base>> puts every object in its own heap
+// allocation and makes a virtual call per element, with the concrete types
+// interleaved, so neither the data cache nor the branch predictor gets much
+// help. PolyCollection<Base> keeps one std::vector<T> segment per concrete type
+// T instead, and visits the elements segment by segment.
+//
+// forEach<Ts...>(f) calls f with a T& for the types listed, so inside those
+// segments the static type is the dynamic type. If T (or T::doWork) is
+// declared final, x.doWork() is then a direct call the compiler can inline.
+// Types not listed are still visited, as Base&, through one virtual call per
+// segment plus an indirect call per element.
+//
+// Like std::vector, inserting may invalidate references into the segment of
+// the inserted type, and elements have to be movable.
+template<typename Base>
+class PolyCollection {
+public:
+    PolyCollection() = default;
+    PolyCollection(PolyCollection&&) = default;
+    PolyCollection& operator=(PolyCollection&&) = default;
+
+    template<typename T, typename... Ts>
+    T& emplace(Ts&&... params)
+    {
+        static_assert(std::is_base_of<Base, T>::value, "T must derive from Base");
+        auto& seg = segment<T>();
+        seg.items.emplace_back(std::forward<Ts>(params)...);
+        ++count;
+        return seg.items.back();
+    }
+
+    template<typename T>
+    T& insert(T&& x)
+    {
+        return emplace<std::decay_t<T>>(std::forward<T>(x));
+    }
+
+    // Room for n more objects of type T, without reallocating.
+    template<typename T>
+    void reserve(std::size_t n)
+    {
+        auto& seg = segment<T>();
+        seg.items.reserve(seg.items.size() + n);
+    }
+
+    std::size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+    std::size_t segmentCount() const noexcept { return segments.size(); }
+
+    template<typename T>
+    std::size_t size() const
+    {
+        auto it = index.find(typeid(T));
+        return it == index.end() ? 0 : segments[it->second]->size();
+    }
+
+    void clear()
+    {
+        for (auto& seg : segments)
+            seg->clear();
+        count = 0;
+    }
+
+    template<typename... Ts, typename F>
+    void forEach(F&& f)
+    {
+        for (auto& seg : segments) {
+            if (!visitAs<Ts...>(*seg, f))
+                seg->forEachBase(&callThrough<F>, &f);
+        }
+    }
+
+private:
+    struct SegmentBase {
+        virtual ~SegmentBase() = default;
+        virtual std::size_t size() const noexcept = 0;
+        virtual void clear() noexcept = 0;
+        virtual void forEachBase(void (*fn)(void*, Base&), void* ctx) = 0;
+    };
+
+    template<typename T>
+    struct Segment : SegmentBase {
+        std::size_t size() const noexcept override { return items.size(); }
+        void clear() noexcept override { items.clear(); }
+        void forEachBase(void (*fn)(void*, Base&), void* ctx) override
+        {
+            for (auto& x : items)
+                fn(ctx, x);
+        }
+        std::vector<T> items;
+    };
+
+    template<typename F>
+    static void callThrough(void* f, Base& x)
+    {
+        (*static_cast<std::remove_reference_t<F>*>(f))(x);
+    }
+
+    template<typename T>
+    Segment<T>& segment()
+    {
+        auto it = index.find(typeid(T));
+        if (it == index.end()) {
+            segments.push_back(std::make_unique<Segment<T>>());
+            it = index.emplace(typeid(T), segments.size() - 1).first;
+        }
+        return static_cast<Segment<T>&>(*segments[it->second]);
+    }
+
+    // Tries each listed type in turn; false if seg holds none of them.
+    template<typename F>
+    static bool visitAs(SegmentBase&, F&)
+    {
+        return false;
+    }
+
+    template<typename T, typename... Rest, typename F>
+    static bool visitAs(SegmentBase& seg, F& f)
+    {
+        if (auto typed = dynamic_cast<Segment<T>*>(&seg)) {
+            for (auto& x : typed->items)
+                f(x);
+            return true;
+        }
+        return visitAs<Rest...>(seg, f);
+    }
+
+    std::vector<std::unique_ptr<SegmentBase>> segments;
+    std::unordered_map<std::type_index, std::size_t> index;
+    std::size_t count { 0 };
+};
+
+#endif // __POLY_COLLECTION__H__
@@ -0,0 +1,88 @@
+#include <memory>
+#include <random>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "PolyCollection.hpp"
+
+
+// Heterogeneous work items: a vector of unique_ptr<WorkItem> in random type
+// order vs a PolyCollection of the same objects. The item types are final,
+// so the typed forEach can call doWork directly.
+
+class WorkItem {
+public:
+    virtual ~WorkItem() = default;
+    virtual void doWork(double& acc) const = 0;
+};
+
+class Scale final : public WorkItem {
+public:
+    explicit Scale(double f) : factor(f) {}
+    void doWork(double& acc) const override { acc += factor * 1.5; }
+private:
+    double factor;
+};
+
+class Offset final : public WorkItem {
+public:
+    explicit Offset(double o) : offset(o) {}
+    void doWork(double& acc) const override { acc += offset; }
+private:
+    double offset;
+};
+
+class Clamp final : public WorkItem {
+public:
+    Clamp(double v, double l, double h) : value(v), lo(l), hi(h) {}
+    void doWork(double& acc) const override { acc += value < lo ? lo : (value > hi ? hi : value); }
+private:
+    double value, lo, hi;
+};
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item12", argc, argv);
+
+    constexpr std::size_t n = 1000000;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> pick(0, 2);
+    std::uniform_real_distribution<double> val(-1.0, 1.0);
+
+    std::vector<std::unique_ptr<WorkItem>> pointers;
+    PolyCollection<WorkItem> segmented;
+    pointers.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto v = val(gen);
+        switch (pick(gen)) {
+        case 0:
+            pointers.push_back(std::make_unique<Scale>(v));
+            segmented.emplace<Scale>(v);
+            break;
+        case 1:
+            pointers.push_back(std::make_unique<Offset>(v));
+            segmented.emplace<Offset>(v);
+            break;
+        default:
+            pointers.push_back(std::make_unique<Clamp>(v, -0.5, 0.5));
+            segmented.emplace<Clamp>(v, -0.5, 0.5);
+        }
+    }
+
+    runner.runBatch("dispatch: vector<unique_ptr<Base>>", n, [&] {
+        double acc = 0;
+        for (const auto& p : pointers)
+            p->doWork(acc);
+        bench::doNotOptimize(acc);
+    });
+    runner.runBatch("dispatch: PolyCollection, as Base&", n, [&] {
+        double acc = 0;
+        segmented.forEach([&](const WorkItem& x) { x.doWork(acc); });
+        bench::doNotOptimize(acc);
+    });
+    runner.runBatch("dispatch: PolyCollection, typed", n, [&] {
+        double acc = 0;
+        segmented.forEach<Scale, Offset, Clamp>([&](const auto& x) { x.doWork(acc); });
+        bench::doNotOptimize(acc);
+    });
+    return runner.finish();
+}
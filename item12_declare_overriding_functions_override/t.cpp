@@ -1,6 +1,9 @@
 #include <iostream>
 #include <memory>
 #include <vector>
+#include <numeric>
+#include "Buffer.hpp"
+#include "PolyCollection.hpp"
 
 // for overriding to occur, several requirements must be met:
 // 1. The base class function must be virtual.
@@ -27,15 +30,24 @@ public:
 
 class Derived: public Base {
 public:
-    virtual void doWork() override
+    // final: nothing overrides it further, so a call through a Derived& can
+    // skip the vtable (see the PolyCollection below)
+    virtual void doWork() override final
     {
         std::cout << "Derived doWork\n";
     }
 };
 
+// data() && moves the values out of a Widget that's about to die anyway.
+// DataType is a Buffer (Buffer.hpp), a shared handle to a pooled block, so
+// the same hand-off works between any stages, and so does passing a slice.
 class Widget {
 public:
-    using DataType = std::vector<double>;
+    using DataType = Buffer;
+    Widget() = default;
+    explicit Widget(DataType v)
+        : values(std::move(v))
+    {}
     void doWork() &  // this version applies only when *this is an lvalue
     {
         std::cout << "lvalue doWork\n";
@@ -61,14 +73,71 @@ Widget makeWidget()  //factory returns rvalue
     return Widget();
 }
 
+// A few processing stages. Each one takes the buffer by value and returns
+// it, so callers hand ownership along with std::move and nothing is copied.
+Buffer produce(BufferPool& pool, std::size_t n)
+{
+    auto buf = pool.acquire(n);
+    std::iota(buf.begin(), buf.end(), 0.0);
+    return buf;
+}
+
+Buffer scale(Buffer buf, double factor)
+{
+    // only the sole owner may write in place
+    if (!buf.unique())
+        buf = buf.clone();
+    for (auto& v : buf)
+        v *= factor;
+    return buf;
+}
+
+Buffer dropHeader(Buffer buf, std::size_t headerSize)
+{
+    return std::move(buf).slice(headerSize);
+}
+
+double consume(Buffer buf)
+{
+    return std::accumulate(buf.begin(), buf.end(), 0.0);
+}
+
 
 int main()
 {
     std::unique_ptr<Base> upb = std::make_unique<Derived>();
     upb->doWork();
 
+    // Same virtual doWork, but objects of each type are stored together.
+    // Inside the Derived segment x is a Derived&, and Derived::doWork is
+    // final, so the call needn't go through the vtable; Base objects aren't
+    // listed and are visited as Base&.
+    PolyCollection<Base> items;
+    items.emplace<Derived>();
+    items.emplace<Base>();
+    items.emplace<Derived>();
+    items.forEach<Derived>([](auto& x) { x.doWork(); });
+
     Widget w;
     w.doWork();
     makeWidget().doWork();
 
+    BufferPool pool;
+    bufferStats().reset();
+    for (int round = 0; round < 3; ++round) {
+        auto raw = produce(pool, 1000);
+        auto id = raw.blockId();
+        Widget stage(std::move(raw));
+        auto payload = dropHeader(scale(std::move(stage).data(), 2.0), 10);
+        std::cout << "round " << round << ": same block " << std::boolalpha
+                  << (payload.blockId() == id) << ", sum " << consume(std::move(payload)) << '\n';
+    }
+    auto& stats = bufferStats();
+    std::cout << "blocks allocated: " << stats.allocations
+              << ", reused: " << stats.reuses
+              << ", returned to pool: " << stats.releases << '\n'
+              << "handle copies: " << stats.handleCopies
+              << ", handle moves: " << stats.handleMoves
+              << ", elements copied: " << stats.elementCopies << '\n';
+
 }
@@ -0,0 +1,232 @@
+#ifndef __SORTED_BLOCKS__H__
+#define __SORTED_BLOCKS__H__
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+
+// An ordered multiset kept as a list of sorted blocks of at most BlockSize
+// elements, plus a contiguous index holding the first element of each block.
+// It's a B+-tree with exactly two levels: the index is the root, the blocks
+// are the leaves.
+//
+// Keeping a sorted std::vector means shifting on average half of it on every
+// insert. Here a lookup is a binary search over the index and then over one
+// block, and an insert shifts at most one block. A full block is split in two,
+// which shifts only the index (n / BlockSize entries). Iteration walks
+// contiguous blocks, so it's nearly as cache friendly as the vector.
+//
+// Inserting invalidates all iterators, like vector::insert.
+template<typename T, std::size_t BlockSize = 512>
+class SortedBlocks {
+    static_assert(BlockSize >= 2, "blocks must hold at least two elements");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return (*blocks)[block][pos]; }
+        pointer operator->() const { return &(*blocks)[block][pos]; }
+        const_iterator& operator++()
+        {
+            if (++pos == (*blocks)[block].size()) {
+                ++block;
+                pos = 0;
+            }
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs)
+        {
+            return lhs.block == rhs.block && lhs.pos == rhs.pos;
+        }
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class SortedBlocks;
+        const_iterator(const std::vector<std::vector<T>>* b, size_type blk, size_type p)
+            : blocks(b), block(blk), pos(p)
+        {}
+
+        const std::vector<std::vector<T>>* blocks { nullptr };
+        size_type block { 0 };
+        size_type pos { 0 };
+    };
+    // Elements are keys; changing one in place could break the order.
+    using iterator = const_iterator;
+
+    SortedBlocks() = default;
+
+    template<typename It>
+    SortedBlocks(It first, It last)
+    {
+        assign(first, last);
+    }
+
+    SortedBlocks(std::initializer_list<T> il)
+        : SortedBlocks(il.begin(), il.end())
+    {}
+
+    // Bulk load: sort once and cut into blocks, O(n log n) instead of n
+    // separate inserts. Blocks are filled to 3/4 to leave room for inserts.
+    template<typename It>
+    void assign(It first, It last)
+    {
+        std::vector<T> sorted(first, last);
+        std::sort(sorted.begin(), sorted.end());
+        loadSorted(sorted);
+    }
+
+    size_type size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+
+    const_iterator begin() const noexcept { return { &blocks, 0, 0 }; }
+    const_iterator end() const noexcept { return { &blocks, blocks.size(), 0 }; }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    // First element not less than v.
+    const_iterator lower_bound(const T& v) const
+    {
+        if (blocks.empty())
+            return end();
+        // Not blockFor: with duplicates, a block may start with v while the
+        // one before it ends with v, and the first v is the one we want.
+        auto it = std::lower_bound(firsts.begin(), firsts.end(), v);
+        auto b = it == firsts.begin() ? 0 : static_cast<size_type>(it - firsts.begin()) - 1;
+        const auto& blk = blocks[b];
+        auto pos = static_cast<size_type>(std::lower_bound(blk.begin(), blk.end(), v) - blk.begin());
+        // v is bigger than everything in block b, so the answer starts block b + 1
+        if (pos == blk.size())
+            return { &blocks, b + 1, 0 };
+        return { &blocks, b, pos };
+    }
+
+    const_iterator find(const T& v) const
+    {
+        auto it = lower_bound(v);
+        return (it != end() && !(v < *it)) ? it : end();
+    }
+
+    bool contains(const T& v) const { return find(v) != end(); }
+
+    const_iterator insert(const T& v)
+    {
+        if (blocks.empty()) {
+            blocks.emplace_back();
+            blocks.back().reserve(BlockSize + 1);
+            blocks.back().push_back(v);
+            firsts.push_back(v);
+            ++count;
+            return begin();
+        }
+        auto b = blockFor(v);
+        auto& blk = blocks[b];
+        auto pos = static_cast<size_type>(std::upper_bound(blk.begin(), blk.end(), v) - blk.begin());
+        blk.insert(blk.begin() + pos, v);
+        if (pos == 0)
+            firsts[b] = v;
+        ++count;
+        if (blk.size() > BlockSize)
+            return split(b, pos);
+        return { &blocks, b, pos };
+    }
+
+    // The hint is accepted for compatibility with sequence containers, as with
+    // std::set::insert(hint, v); the order alone decides where v goes.
+    const_iterator insert(const_iterator /*hint*/, const T& v)
+    {
+        return insert(v);
+    }
+
+    // Batch insert. A batch that's small next to the container goes in one by
+    // one; a large one is sorted and merged in a single pass and the blocks
+    // rebuilt, which is linear in the total size.
+    template<typename It>
+    void insert(It first, It last)
+    {
+        std::vector<T> batch(first, last);
+        if (batch.size() * 16 < count) {
+            for (const auto& v : batch)
+                insert(v);
+            return;
+        }
+        std::sort(batch.begin(), batch.end());
+        std::vector<T> merged;
+        merged.reserve(count + batch.size());
+        std::merge(begin(), end(), batch.begin(), batch.end(), std::back_inserter(merged));
+        loadSorted(merged);
+    }
+
+    void clear() noexcept
+    {
+        blocks.clear();
+        firsts.clear();
+        count = 0;
+    }
+
+private:
+    // The block a new v goes in: the last one whose first element is <= v, or
+    // block 0 if v is smaller than everything.
+    size_type blockFor(const T& v) const
+    {
+        auto it = std::upper_bound(firsts.begin(), firsts.end(), v);
+        return it == firsts.begin() ? 0 : static_cast<size_type>(it - firsts.begin()) - 1;
+    }
+
+    // Splits overfull block b in half; returns where element pos of it went.
+    const_iterator split(size_type b, size_type pos)
+    {
+        auto half = blocks[b].size() / 2;
+        std::vector<T> upper;
+        upper.reserve(BlockSize + 1);
+        upper.assign(blocks[b].begin() + half, blocks[b].end());
+        blocks[b].erase(blocks[b].begin() + half, blocks[b].end());
+        firsts.insert(firsts.begin() + b + 1, upper.front());
+        blocks.insert(blocks.begin() + b + 1, std::move(upper));
+        if (pos < half)
+            return { &blocks, b, pos };
+        return { &blocks, b + 1, pos - half };
+    }
+
+    void loadSorted(const std::vector<T>& sorted)
+    {
+        clear();
+        const size_type fill = BlockSize * 3 / 4;
+        for (size_type i = 0; i < sorted.size(); i += fill) {
+            auto last = std::min(i + fill, sorted.size());
+            blocks.emplace_back();
+            blocks.back().reserve(BlockSize + 1);
+            blocks.back().assign(sorted.begin() + i, sorted.begin() + last);
+            firsts.push_back(sorted[i]);
+        }
+        count = sorted.size();
+    }
+
+    std::vector<std::vector<T>> blocks;
+    std::vector<T> firsts;
+    size_type count { 0 };
+};
+
+#endif // __SORTED_BLOCKS__H__
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "SortedBlocks.hpp"
+
+
+// Keeping an ordered set of ints: a std::vector maintained the way
+// findAndInsert does it (linear std::find, then insert), a std::vector kept
+// sorted with std::lower_bound, and SortedBlocks. Search, insert, iterate and
+// bulk load are timed separately.
+
+std::vector<int> randomInts(std::size_t n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(0, 1 << 30);
+    std::vector<int> v(n);
+    for (auto& x : v)
+        x = dist(gen);
+    return v;
+}
+
+// Small blocks so that splits and multi-block duplicates actually happen.
+void check()
+{
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> dist(0, 200);
+    SortedBlocks<int, 4> blocks;
+    std::vector<int> ref;
+    for (int i = 0; i < 5000; ++i) {
+        auto v = dist(gen);
+        blocks.insert(v);
+        ref.insert(std::upper_bound(ref.begin(), ref.end(), v), v);
+        if (i % 1000 == 999) {
+            auto batch = randomInts(300, i);
+            for (auto& x : batch)
+                x %= 200;
+            blocks.insert(batch.begin(), batch.end());
+            ref.insert(ref.end(), batch.begin(), batch.end());
+            std::sort(ref.begin(), ref.end());
+        }
+    }
+    bool ok = blocks.size() == ref.size() && std::equal(ref.begin(), ref.end(), blocks.begin());
+    for (int v = -1; ok && v <= 201; ++v) {
+        auto n = std::distance(blocks.begin(), blocks.lower_bound(v));
+        ok = n == std::lower_bound(ref.begin(), ref.end(), v) - ref.begin();
+        ok = ok && blocks.contains(v) == std::binary_search(ref.begin(), ref.end(), v);
+    }
+    if (!ok) {
+        std::cerr << "SortedBlocks disagrees with a sorted vector\n";
+        std::exit(1);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item13", argc, argv);
+    check();
+
+    // Both vector patterns are O(n) per insert, so they only get the first
+    // small / medium keys; SortedBlocks gets the full million.
+    constexpr std::size_t small = 20000;
+    constexpr std::size_t medium = 200000;
+    constexpr std::size_t n = 1000000;
+    auto keys = randomInts(n, 42);
+    auto probes = randomInts(n, 43);
+
+    std::vector<int> vec;
+    runner.runBatch("insert: vector std::find + insert (n=20k)", small, [&] { vec.clear(); }, [&] {
+        for (std::size_t i = 0; i < small; ++i) {
+            auto it = std::find_if(vec.cbegin(), vec.cend(), [&](int x) { return x >= keys[i]; });
+            vec.insert(it, keys[i]);
+        }
+    });
+    runner.runBatch("insert: sorted vector lower_bound (n=200k)", medium, [&] { vec.clear(); }, [&] {
+        for (std::size_t i = 0; i < medium; ++i)
+            vec.insert(std::lower_bound(vec.begin(), vec.end(), keys[i]), keys[i]);
+    });
+    SortedBlocks<int> blocks;
+    runner.runBatch("insert: SortedBlocks (n=1M)", n, [&] { blocks.clear(); }, [&] {
+        for (auto k : keys)
+            blocks.insert(k);
+    });
+
+    vec.assign(keys.begin(), keys.end());
+    std::sort(vec.begin(), vec.end());
+    blocks.assign(keys.begin(), keys.end());
+    runner.runBatch("search: sorted vector binary_search", n, [&] {
+        std::size_t found = 0;
+        for (auto p : probes)
+            found += std::binary_search(vec.begin(), vec.end(), p);
+        bench::doNotOptimize(found);
+    });
+    runner.runBatch("search: SortedBlocks find", n, [&] {
+        std::size_t found = 0;
+        for (auto p : probes)
+            found += blocks.contains(p);
+        bench::doNotOptimize(found);
+    });
+
+    runner.runBatch("iterate: sorted vector", n, [&] {
+        long long sum = 0;
+        for (auto x : vec)
+            sum += x;
+        bench::doNotOptimize(sum);
+    });
+    runner.runBatch("iterate: SortedBlocks", n, [&] {
+        long long sum = 0;
+        for (auto x : blocks)
+            sum += x;
+        bench::doNotOptimize(sum);
+    });
+
+    runner.runBatch("bulk load: sorted vector (std::sort)", n, [&] {
+        vec.assign(keys.begin(), keys.end());
+        std::sort(vec.begin(), vec.end());
+    });
+    runner.runBatch("bulk load: SortedBlocks::assign", n, [&] {
+        blocks.assign(keys.begin(), keys.end());
+    });
+    runner.runBatch("batch insert 10%: SortedBlocks", n / 10,
+                    [&] { blocks.assign(keys.begin(), keys.end()); },
+                    [&] { blocks.insert(probes.begin(), probes.begin() + n / 10); });
+
+    return runner.finish();
+}
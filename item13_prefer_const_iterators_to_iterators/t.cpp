@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include "SortedBlocks.hpp"
 
 
 template<typename C, typename V>
@@ -14,6 +15,16 @@ void findAndInsert(C& container, const V& targetVal, const V& insertVal)
     container.insert(it, insertVal);
 }
 
+// For an ordered container the insert position is decided by insertVal
+// itself: wherever targetVal is, insertVal goes where it sorts. So the same
+// API skips the search (std::find would be a linear scan) and inserts
+// insertVal directly, with one binary search of its own.
+template<typename T, std::size_t BlockSize, typename V>
+void findAndInsert(SortedBlocks<T, BlockSize>& container, const V& /*targetVal*/, const V& insertVal)
+{
+    container.insert(insertVal);
+}
+
 template<typename C>
 auto cbegin(const C& container)->decltype(std::begin(container))
 {
@@ -30,4 +41,13 @@ int main()
     findAndInsert(vec, 3, 6);
     std::copy(vec.begin(), vec.end(), std::ostream_iterator<int>(std::cout, " "));
     std::cout << '\n';
+
+    SortedBlocks<int> sorted { 5, 1, 4, 2, 3 };
+    findAndInsert(sorted, 3, 6);
+    std::copy(sorted.cbegin(), sorted.cend(), std::ostream_iterator<int>(std::cout, " "));
+    std::cout << '\n';
+    std::vector<int> batch { 0, 7, 3 };
+    sorted.insert(batch.cbegin(), batch.cend());
+    std::copy(sorted.cbegin(), sorted.cend(), std::ostream_iterator<int>(std::cout, " "));
+    std::cout << '\n';
 }
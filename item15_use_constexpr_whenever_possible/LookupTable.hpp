@@ -0,0 +1,87 @@
+#ifndef __LOOKUP_TABLE__H__
+#define __LOOKUP_TABLE__H__
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+// Exponentiation by squaring: O(log exp) multiplications instead of the O(exp)
+// of pow11/pow14. Every intermediate product is computed in long long and
+// compared against int's range, so overflow is detected instead of silently
+// wrapping (which would be undefined behavior for int anyway).
+//
+// A throw expression is allowed in a C++14 constexpr function as long as it's
+// not reached during constant evaluation, so an overflowing call in a constexpr
+// context is a compile error, and at runtime it's a std::overflow_error.
+constexpr
+int checkedMul(int lhs, int rhs)
+{
+    long long product = static_cast<long long>(lhs) * rhs;
+    if (product > std::numeric_limits<int>::max() ||
+        product < std::numeric_limits<int>::min())
+        throw std::overflow_error("int overflow in pow");
+    return static_cast<int>(product);
+}
+
+constexpr
+int powBySquaring(int base, unsigned exp)
+{
+    auto result = 1;
+    while (exp != 0) {
+        if (exp & 1u)
+            result = checkedMul(result, base);
+        exp >>= 1;
+        // don't square once more after the last bit, it may overflow needlessly
+        if (exp != 0)
+            base = checkedMul(base, base);
+    }
+    return result;
+}
+
+// Function object computing base^exp, usable as a table generator.
+template<int Base>
+struct Pow {
+    constexpr int operator()(std::size_t exp) const
+    {
+        return powBySquaring(Base, static_cast<unsigned>(exp));
+    }
+};
+
+// makeTable<N>(f) evaluates f(0), f(1), ..., f(N-1) and returns them as a
+// std::array. C++14 lambdas can't be constexpr, so f has to be a literal
+// function object with a constexpr operator() (like Pow above). Assigned to
+// a constexpr variable, the whole table is built by the compiler and lands
+// in read-only data; nothing is computed at runtime.
+namespace detail {
+
+template<typename F, std::size_t... I>
+constexpr auto makeTableImpl(F f, std::index_sequence<I...>)
+    -> std::array<decltype(f(std::size_t{})), sizeof...(I)>
+{
+    return {{ f(I)... }};
+}
+
+} // namespace detail
+
+template<std::size_t N, typename F>
+constexpr auto makeTable(F f)
+    -> std::array<decltype(f(std::size_t{})), N>
+{
+    return detail::makeTableImpl(f, std::make_index_sequence<N>{});
+}
+
+// All powers of Base that fit in an int: Base^0 .. Base^(N-1).
+template<int Base, std::size_t N>
+struct PowTable {
+    static constexpr std::array<int, N> values = makeTable<N>(Pow<Base>{});
+
+    static constexpr int get(std::size_t exp) { return values[exp]; }
+};
+
+template<int Base, std::size_t N>
+constexpr std::array<int, N> PowTable<Base, N>::values;
+
+#endif // __LOOKUP_TABLE__H__
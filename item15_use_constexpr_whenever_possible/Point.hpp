@@ -0,0 +1,58 @@
+#ifndef __POINT__H__
+#define __POINT__H__
+
+#include <cmath>
+
+// In C++11, all built-in types except void qualify as literal types, but user-defined
+// types may be literal too. Because constructors and other member functions may be
+// constexpr:
+
+class Point {
+public:
+    constexpr Point(double xVal = 0, double yVal = 0) noexcept
+        : x(xVal), y(yVal)
+    {}
+
+    constexpr double xValue() const noexcept { return x; }
+    constexpr double yValue() const noexcept { return y; }
+
+    // In C++11, two restrictions prevent Point's member functions setX and setY from
+    // being declared constexpr. First, they modify the object they operate on, and in
+    // C++11, constexpr member functions are implicitly const. Second, they have void
+    // return types, and void isn't a literal type in C++11. Both these restrictions 
+    // are lifted in C++14, even Point's setters can be constexpr:
+    //void setX(double newX) noexcept { x = newX; }
+    //void setY(double newY) noexcept { y = newY; }
+    constexpr void setX(double newX) noexcept { x = newX; }
+    constexpr void setY(double newY) noexcept { y = newY; }
+
+private:
+    double x, y;
+};
+
+constexpr
+Point midpoint(const Point& p1, const Point& p2) noexcept
+{
+    return {
+        (p1.xValue() + p2.xValue()) / 2,
+        (p1.yValue() + p2.yValue()) / 2
+    };
+}
+
+constexpr Point reflection(const Point& p) noexcept
+{
+    Point result;
+    result.setX(-p.xValue());
+    result.setY(-p.yValue());
+
+    return result;
+}
+
+// std::sqrt isn't constexpr, so this one is runtime only. It's the scalar
+// reference for the batch kernels in PointBuffer.hpp.
+inline double distanceFromOrigin(const Point& p) noexcept
+{
+    return std::sqrt((p.xValue() * p.xValue()) + (p.yValue() * p.yValue()));
+}
+
+#endif // __POINT__H__
@@ -0,0 +1,276 @@
+#ifndef __POINT_BUFFER__H__
+#define __POINT_BUFFER__H__
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "Point.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define POINT_BUFFER_X86 1
+#include <immintrin.h>
+#endif
+
+
+// Point is an array-of-structs friendly type: x and y of one point sit next to
+// each other. For batches of millions of points, a struct-of-arrays layout is
+// what vector units want: all x's contiguous, all y's contiguous, so one load
+// brings in 2 (SSE2) or 4 (AVX2) x's at once.
+class PointBuffer {
+public:
+    PointBuffer() = default;
+    explicit PointBuffer(std::size_t n)
+        : xs(n), ys(n)
+    {}
+
+    std::size_t size() const noexcept { return xs.size(); }
+    void resize(std::size_t n) { xs.resize(n); ys.resize(n); }
+    void reserve(std::size_t n) { xs.reserve(n); ys.reserve(n); }
+
+    void push_back(const Point& p)
+    {
+        xs.push_back(p.xValue());
+        ys.push_back(p.yValue());
+    }
+    Point operator[](std::size_t i) const noexcept { return { xs[i], ys[i] }; }
+    void set(std::size_t i, const Point& p) noexcept
+    {
+        xs[i] = p.xValue();
+        ys[i] = p.yValue();
+    }
+
+    double* x() noexcept { return xs.data(); }
+    double* y() noexcept { return ys.data(); }
+    const double* x() const noexcept { return xs.data(); }
+    const double* y() const noexcept { return ys.data(); }
+
+private:
+    std::vector<double> xs, ys;
+};
+
+
+// Which instruction set the batch kernels run on. bestSimdLevel() is what the CPU
+// we're running on supports, checked once at runtime, so the same binary runs
+// the AVX2 kernels where they exist and falls back everywhere else.
+enum class SimdLevel { scalar, sse2, avx2 };
+
+inline const char* toString(SimdLevel level) noexcept
+{
+    switch (level) {
+    case SimdLevel::avx2: return "avx2";
+    case SimdLevel::sse2: return "sse2";
+    default:              return "scalar";
+    }
+}
+
+inline SimdLevel detectSimdLevel() noexcept
+{
+#ifdef POINT_BUFFER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::sse2;
+#endif
+    return SimdLevel::scalar;
+}
+
+inline SimdLevel bestSimdLevel() noexcept
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+// Asking for more than the CPU has gets the best it does have.
+inline SimdLevel usableSimdLevel(SimdLevel requested) noexcept
+{
+    return requested < bestSimdLevel() ? requested : bestSimdLevel();
+}
+
+
+// The kernels work on raw arrays, one function per instruction set. Each
+// vector loop is followed by a scalar loop for the leftover tail. The scalar
+// versions do exactly what Point's midpoint/reflection/distanceFromOrigin do,
+// and every vector op used here (add, mul, sqrt, sign flip) is correctly
+// rounded, so all levels give bit-identical results.
+namespace kernels {
+
+inline void midpointScalar(const double* ax, const double* ay,
+                           const double* bx, const double* by,
+                           double* ox, double* oy,
+                           std::size_t begin, std::size_t n) noexcept
+{
+    for (auto i = begin; i < n; ++i) {
+        ox[i] = (ax[i] + bx[i]) / 2;
+        oy[i] = (ay[i] + by[i]) / 2;
+    }
+}
+
+inline void reflectionScalar(const double* ix, const double* iy,
+                             double* ox, double* oy,
+                             std::size_t begin, std::size_t n) noexcept
+{
+    for (auto i = begin; i < n; ++i) {
+        ox[i] = -ix[i];
+        oy[i] = -iy[i];
+    }
+}
+
+inline void distanceScalar(const double* ix, const double* iy, double* out,
+                           std::size_t begin, std::size_t n) noexcept
+{
+    for (auto i = begin; i < n; ++i)
+        out[i] = std::sqrt((ix[i] * ix[i]) + (iy[i] * iy[i]));
+}
+
+#ifdef POINT_BUFFER_X86
+__attribute__((target("sse2")))
+inline void midpointSse2(const double* ax, const double* ay,
+                         const double* bx, const double* by,
+                         double* ox, double* oy, std::size_t n) noexcept
+{
+    const auto half = _mm_set1_pd(0.5);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto x = _mm_add_pd(_mm_loadu_pd(ax + i), _mm_loadu_pd(bx + i));
+        auto y = _mm_add_pd(_mm_loadu_pd(ay + i), _mm_loadu_pd(by + i));
+        _mm_storeu_pd(ox + i, _mm_mul_pd(x, half));
+        _mm_storeu_pd(oy + i, _mm_mul_pd(y, half));
+    }
+    midpointScalar(ax, ay, bx, by, ox, oy, i, n);
+}
+
+__attribute__((target("sse2")))
+inline void reflectionSse2(const double* ix, const double* iy,
+                           double* ox, double* oy, std::size_t n) noexcept
+{
+    const auto sign = _mm_set1_pd(-0.0);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(ox + i, _mm_xor_pd(_mm_loadu_pd(ix + i), sign));
+        _mm_storeu_pd(oy + i, _mm_xor_pd(_mm_loadu_pd(iy + i), sign));
+    }
+    reflectionScalar(ix, iy, ox, oy, i, n);
+}
+
+__attribute__((target("sse2")))
+inline void distanceSse2(const double* ix, const double* iy, double* out,
+                         std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto x = _mm_loadu_pd(ix + i);
+        auto y = _mm_loadu_pd(iy + i);
+        auto sq = _mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y));
+        _mm_storeu_pd(out + i, _mm_sqrt_pd(sq));
+    }
+    distanceScalar(ix, iy, out, i, n);
+}
+
+__attribute__((target("avx2")))
+inline void midpointAvx2(const double* ax, const double* ay,
+                         const double* bx, const double* by,
+                         double* ox, double* oy, std::size_t n) noexcept
+{
+    const auto half = _mm256_set1_pd(0.5);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm256_add_pd(_mm256_loadu_pd(ax + i), _mm256_loadu_pd(bx + i));
+        auto y = _mm256_add_pd(_mm256_loadu_pd(ay + i), _mm256_loadu_pd(by + i));
+        _mm256_storeu_pd(ox + i, _mm256_mul_pd(x, half));
+        _mm256_storeu_pd(oy + i, _mm256_mul_pd(y, half));
+    }
+    midpointScalar(ax, ay, bx, by, ox, oy, i, n);
+}
+
+__attribute__((target("avx2")))
+inline void reflectionAvx2(const double* ix, const double* iy,
+                           double* ox, double* oy, std::size_t n) noexcept
+{
+    const auto sign = _mm256_set1_pd(-0.0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(ox + i, _mm256_xor_pd(_mm256_loadu_pd(ix + i), sign));
+        _mm256_storeu_pd(oy + i, _mm256_xor_pd(_mm256_loadu_pd(iy + i), sign));
+    }
+    reflectionScalar(ix, iy, ox, oy, i, n);
+}
+
+__attribute__((target("avx2")))
+inline void distanceAvx2(const double* ix, const double* iy, double* out,
+                         std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm256_loadu_pd(ix + i);
+        auto y = _mm256_loadu_pd(iy + i);
+        auto sq = _mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y));
+        _mm256_storeu_pd(out + i, _mm256_sqrt_pd(sq));
+    }
+    distanceScalar(ix, iy, out, i, n);
+}
+#endif
+
+} // namespace kernels
+
+
+// Batch versions of midpoint, reflection and distanceFromOrigin. out may alias
+// an input (the kernels are strictly element-wise). The level parameter is
+// there for tests and benchmarks; by default the best available one is used.
+inline void midpoints(const PointBuffer& a, const PointBuffer& b, PointBuffer& out,
+                      SimdLevel level = bestSimdLevel())
+{
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    switch (usableSimdLevel(level)) {
+#ifdef POINT_BUFFER_X86
+    case SimdLevel::avx2:
+        kernels::midpointAvx2(a.x(), a.y(), b.x(), b.y(), out.x(), out.y(), a.size());
+        return;
+    case SimdLevel::sse2:
+        kernels::midpointSse2(a.x(), a.y(), b.x(), b.y(), out.x(), out.y(), a.size());
+        return;
+#endif
+    default:
+        kernels::midpointScalar(a.x(), a.y(), b.x(), b.y(), out.x(), out.y(), 0, a.size());
+    }
+}
+
+inline void reflections(const PointBuffer& in, PointBuffer& out,
+                        SimdLevel level = bestSimdLevel())
+{
+    out.resize(in.size());
+    switch (usableSimdLevel(level)) {
+#ifdef POINT_BUFFER_X86
+    case SimdLevel::avx2:
+        kernels::reflectionAvx2(in.x(), in.y(), out.x(), out.y(), in.size());
+        return;
+    case SimdLevel::sse2:
+        kernels::reflectionSse2(in.x(), in.y(), out.x(), out.y(), in.size());
+        return;
+#endif
+    default:
+        kernels::reflectionScalar(in.x(), in.y(), out.x(), out.y(), 0, in.size());
+    }
+}
+
+inline void distancesFromOrigin(const PointBuffer& in, std::vector<double>& out,
+                                SimdLevel level = bestSimdLevel())
+{
+    out.resize(in.size());
+    switch (usableSimdLevel(level)) {
+#ifdef POINT_BUFFER_X86
+    case SimdLevel::avx2:
+        kernels::distanceAvx2(in.x(), in.y(), out.data(), in.size());
+        return;
+    case SimdLevel::sse2:
+        kernels::distanceSse2(in.x(), in.y(), out.data(), in.size());
+        return;
+#endif
+    default:
+        kernels::distanceScalar(in.x(), in.y(), out.data(), 0, in.size());
+    }
+}
+
+#endif // __POINT_BUFFER__H__
@@ -0,0 +1,113 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "LookupTable.hpp"
+#include "Point.hpp"
+#include "PointBuffer.hpp"
+
+
+// 1. Table lookup vs computing base^exp on the fly, over the same random
+//    exponents.
+// 2. Batch point kernels on every SIMD level this CPU has, checked against
+//    the constexpr scalar Point first.
+
+constexpr int pow14(int base, int exp) noexcept
+{
+    auto result = 1;
+    for (int i = 0; i < exp; ++i)
+        result *= base;
+    return result;
+}
+
+template<typename F>
+void runPow(bench::Runner& runner, const char* name, const std::vector<unsigned>& exps, F f)
+{
+    runner.runBatch(name, exps.size(), [&] {
+        long long sum = 0;
+        for (auto e : exps)
+            sum += f(e);
+        bench::doNotOptimize(sum);
+    });
+}
+
+// Every level has to agree with Point, element for element. An odd size
+// exercises the scalar tails after the vector loops.
+void checkKernels(SimdLevel level)
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    PointBuffer as, bs;
+    for (int i = 0; i < 1003; ++i) {
+        as.push_back({ dist(gen), dist(gen) });
+        bs.push_back({ dist(gen), dist(gen) });
+    }
+    PointBuffer mids, reflected;
+    std::vector<double> distances;
+    midpoints(as, bs, mids, level);
+    reflections(as, reflected, level);
+    distancesFromOrigin(as, distances, level);
+    for (std::size_t i = 0; i < as.size(); ++i) {
+        auto mid = midpoint(as[i], bs[i]);
+        auto ref = reflection(as[i]);
+        if (mids[i].xValue() != mid.xValue() || mids[i].yValue() != mid.yValue() ||
+            reflected[i].xValue() != ref.xValue() || reflected[i].yValue() != ref.yValue() ||
+            distances[i] != distanceFromOrigin(as[i])) {
+            std::cerr << toString(level) << " kernels disagree with Point at " << i << '\n';
+            std::exit(1);
+        }
+    }
+}
+
+void benchPoints(bench::Runner& runner)
+{
+    constexpr std::size_t n = 10000000;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    PointBuffer as, bs;
+    as.reserve(n);
+    bs.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        as.push_back({ dist(gen), dist(gen) });
+        bs.push_back({ dist(gen), dist(gen) });
+    }
+    PointBuffer out(n);
+    std::vector<double> distances(n);
+
+    for (auto level : { SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2 }) {
+        if (level > bestSimdLevel())
+            continue;
+        checkKernels(level);
+        std::string suffix = std::string(" [") + toString(level) + "]";
+        runner.runBatch("midpoints" + suffix, n, [&] { midpoints(as, bs, out, level); });
+        runner.runBatch("reflections" + suffix, n, [&] { reflections(as, out, level); });
+        runner.runBatch("distancesFromOrigin" + suffix, n,
+                        [&] { distancesFromOrigin(as, distances, level); });
+    }
+    bench::doNotOptimize(out);
+    bench::doNotOptimize(distances);
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item15", argc, argv);
+
+    constexpr auto maxExp = 20u;  // 3^19 is the largest power of 3 in an int
+    std::vector<unsigned> exps(10000000);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<unsigned> dist(0, maxExp - 1);
+    for (auto& e : exps)
+        e = dist(gen);
+
+    runPow(runner, "pow: PowTable lookup", exps,
+           [](unsigned e) { return PowTable<3, maxExp>::get(e); });
+    runPow(runner, "pow: powBySquaring", exps,
+           [](unsigned e) { return powBySquaring(3, e); });
+    runPow(runner, "pow: pow14 (linear)", exps,
+           [](unsigned e) { return pow14(3, static_cast<int>(e)); });
+
+    benchPoints(runner);
+    return runner.finish();
+}
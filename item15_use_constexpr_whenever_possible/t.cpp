@@ -1,7 +1,10 @@
 #include <iostream>
 #include <string>
 #include <array>
-
+#include <stdexcept>
+#include "LookupTable.hpp"
+#include "Point.hpp"
+#include "PointBuffer.hpp"
 
 // Conceptually, constexpr indicates a value that's not only const,
 // it's known during compilation.
@@ -41,60 +44,74 @@ int pow14(int base, int exp) noexcept
     return result;
 }
 
-// In C++11, all built-in types except void qualify as literal types, but user-defined
-// types may be literal too. Because constructors and other member functions may be
-// constexpr:
-
-class Point {
-public:
-    constexpr Point(double xVal = 0, double yVal = 0) noexcept
-        : x(xVal), y(yVal)
-    {}
-
-    constexpr double xValue() const noexcept { return x; }
-    constexpr double yValue() const noexcept { return y; }
-
-    // In C++11, two restrictions prevent Point's member functions setX and setY from
-    // being declared constexpr. First, they modify the object they operate on, and in
-    // C++11, constexpr member functions are implicitly const. Second, they have void
-    // return types, and void isn't a literal type in C++11. Both these restrictions 
-    // are lifted in C++14, even Point's setters can be constexpr:
-    //void setX(double newX) noexcept { x = newX; }
-    //void setY(double newY) noexcept { y = newY; }
-    constexpr void setX(double newX) noexcept { x = newX; }
-    constexpr void setY(double newY) noexcept { y = newY; }
-
-private:
-    double x, y;
+// Both of them are linear in exp and overflow silently. powBySquaring in
+// LookupTable.hpp takes O(log exp) steps and throws std::overflow_error instead.
+//
+// Since constexpr functions can run at compile time, they can also generate
+// whole tables at compile time. Each of the 3^numConds results below stands for
+// one combination of numConds conditions that are each in one of three states;
+// the table stores how many conditions of that combination are in state 2.
+template<int NumConds>
+struct ConditionsInState2 {
+    constexpr int operator()(std::size_t combination) const
+    {
+        auto count = 0;
+        for (int i = 0; i < NumConds; ++i) {
+            if (combination % 3 == 2)
+                ++count;
+            combination /= 3;
+        }
+        return count;
+    }
 };
 
-constexpr
-Point midpoint(const Point& p1, const Point& p2) noexcept
-{
-    return {
-        (p1.xValue() + p2.xValue()) / 2,
-        (p1.yValue() + p1.yValue()) / 2
-    };
-}
-
-constexpr Point reflection(const Point& p) noexcept
-{
-    Point result;
-    result.setX(-p.xValue());
-    result.setY(-p.yValue());
-
-    return result;
-}
+// Point, a literal type with constexpr members, lives in Point.hpp.
 
 int main()
 {
     constexpr auto numConds = 5;
-    std::array<int, pow11(3, numConds)> results;
+    constexpr std::array<int, pow11(3, numConds)> results =
+        makeTable<pow11(3, numConds)>(ConditionsInState2<numConds>{});
+    static_assert(results.size() == pow14(3, numConds), "");
+    static_assert(results[pow14(3, numConds) - 1] == numConds, "");
+    std::cout << "conditions in state 2 for combination 100: " << results[100] << '\n';
+
+    static_assert(powBySquaring(3, 19) == 1162261467, "");
+    static_assert(PowTable<3, 20>::get(19) == powBySquaring(3, 19), "");
+    std::cout << "3^19 = " << PowTable<3, 20>::get(19) << '\n';
+    try {
+        powBySquaring(3, 20);
+    } catch (const std::overflow_error& e) {
+        std::cout << "3^20: " << e.what() << '\n';
+    }
 
     constexpr Point p1(9.4, 27.7);
     constexpr Point p2(28.8, 5.3);
     constexpr auto mid = midpoint(p1, p2);
 
     constexpr auto reflectMid = reflection(mid);
+    static_assert(mid.yValue() == (p1.yValue() + p2.yValue()) / 2, "");
+    std::cout << "reflection of midpoint: (" << reflectMid.xValue() << ", "
+              << reflectMid.yValue() << ")\n";
+
+    // The same operations over whole batches of points, on the widest
+    // vector instructions this CPU supports.
+    PointBuffer as, bs;
+    for (int i = 0; i < 5; ++i) {
+        as.push_back({ p1.xValue() * i, p1.yValue() * i });
+        bs.push_back({ p2.xValue() * i, p2.yValue() * i });
+    }
+    PointBuffer mids, reflected;
+    std::vector<double> distances;
+    midpoints(as, bs, mids);
+    reflections(mids, reflected);
+    distancesFromOrigin(reflected, distances);
+    std::cout << "batch kernels use " << toString(bestSimdLevel()) << '\n';
+    for (std::size_t i = 0; i < mids.size(); ++i) {
+        auto ref = reflection(midpoint(as[i], bs[i]));
+        std::cout << "(" << reflected[i].xValue() << ", " << reflected[i].yValue()
+                  << ") distance " << distances[i]
+                  << (distances[i] == distanceFromOrigin(ref) ? "" : " MISMATCH") << '\n';
+    }
 
 }
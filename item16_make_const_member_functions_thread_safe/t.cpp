@@ -4,6 +4,7 @@
 #include <mutex>
 #include <atomic>
 #include <cmath>
+#include "../common/AdaptiveMutex.hpp"
 
 
 class Polynomial {
@@ -20,7 +21,7 @@ public:
     //}
     RootsType roots() const
     {
-        std::lock_guard<std::mutex> g(m);
+        std::lock_guard<MutexType> g(m);
         if (!rootsAreValid) {
             rootVals = { 1,2,3,4,5 };
             rootsAreValid = true;
@@ -51,7 +52,10 @@ public:
 private:
     // std::mutex is a move-only type which makes Polynomial
     // loses the ability to be copied.
-    mutable std::mutex m;
+    // The critical section in roots() is tiny, so a mutex that spins briefly
+    // before sleeping suits it better than std::mutex; any Lockable type works.
+    using MutexType = AdaptiveMutex;
+    mutable MutexType m;
     mutable bool rootsAreValid { false };
     mutable RootsType rootVals {};
     mutable std::atomic<bool> cacheValid { false };
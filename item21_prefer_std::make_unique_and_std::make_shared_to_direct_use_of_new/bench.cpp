@@ -0,0 +1,114 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "../common/Bench.hpp"
+#include "../common/Expected.hpp"
+
+
+// make_shared does one allocation for the Widget and its control block,
+// shared_ptr<Widget>(new Widget) does two. For unique_ptr there's no control
+// block, so make_unique and new should cost the same.
+//
+// Then computePriority's two error channels: throwing a runtime_error and
+// catching it, against returning Expected<int>, on the success path and on
+// the failure path, and a three-step chain of each (three calls in a try
+// block, three and_then steps).
+
+class Widget {
+public:
+    Widget() = default;
+    Widget(int number)
+        : _number(number)
+    {}
+    int number() const noexcept { return _number; }
+private:
+    int _number { 0 };
+};
+
+// Read through a volatile so the compiler can't see which way it goes.
+volatile bool failing = false;
+
+int computePriority()
+{
+    if (failing)
+        throw std::runtime_error("exception");
+    return 42;
+}
+
+Expected<int> computePriorityChecked()
+{
+    if (failing)
+        return makeUnexpected(std::errc::operation_not_permitted);
+    return 42;
+}
+
+Expected<int> adjust(int priority)
+{
+    if (failing)
+        return makeUnexpected(std::errc::operation_not_permitted);
+    return priority + 1;
+}
+
+int adjustOrThrow(int priority)
+{
+    if (failing)
+        throw std::runtime_error("exception");
+    return priority + 1;
+}
+
+void errorRows(bench::Runner& runner, const std::string& path)
+{
+    runner.run("error channel, " + path + ": throw/catch", [] {
+        int p;
+        try {
+            p = computePriority();
+        } catch (const std::runtime_error&) {
+            p = -1;
+        }
+        bench::doNotOptimize(p);
+    });
+    runner.run("error channel, " + path + ": Expected", [] {
+        bench::doNotOptimize(computePriorityChecked().value_or(-1));
+    });
+    runner.run("error channel, " + path + ", 3 steps: throw/catch", [] {
+        int p;
+        try {
+            p = adjustOrThrow(adjustOrThrow(computePriority()));
+        } catch (const std::runtime_error&) {
+            p = -1;
+        }
+        bench::doNotOptimize(p);
+    });
+    runner.run("error channel, " + path + ", 3 steps: Expected", [] {
+        bench::doNotOptimize(computePriorityChecked().and_then(adjust).and_then(adjust).value_or(-1));
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item21", argc, argv);
+
+    runner.run("shared_ptr: std::make_shared", [] {
+        auto spw = std::make_shared<Widget>(42);
+        bench::doNotOptimize(spw);
+    });
+    runner.run("shared_ptr: shared_ptr(new Widget)", [] {
+        std::shared_ptr<Widget> spw(new Widget(42));
+        bench::doNotOptimize(spw);
+    });
+    runner.run("unique_ptr: std::make_unique", [] {
+        auto upw = std::make_unique<Widget>(42);
+        bench::doNotOptimize(upw);
+    });
+    runner.run("unique_ptr: unique_ptr(new Widget)", [] {
+        std::unique_ptr<Widget> upw(new Widget(42));
+        bench::doNotOptimize(upw);
+    });
+
+    failing = false;
+    errorRows(runner, "success");
+    failing = true;
+    errorRows(runner, "failure");
+
+    return runner.finish();
+}
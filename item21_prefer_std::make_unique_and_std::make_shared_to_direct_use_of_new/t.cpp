@@ -2,6 +2,7 @@
 #include <iostream>
 #include <exception>
 #include <vector>
+#include "../common/Expected.hpp"
 
 template<typename T, typename... Ts>
 std::unique_ptr<T> make_unique(Ts&&... params)
@@ -28,6 +29,13 @@ int computePriority()
     throw std::runtime_error("exception");
 }
 
+// The same failure as a returned error: nothing is thrown, so there's
+// nothing to leak a raw pointer past, and the caller decides what to do.
+Expected<int> computePriorityChecked()
+{
+    return makeUnexpected(std::errc::operation_not_permitted);
+}
+
 void processWidget(std::shared_ptr<Widget> spw, int priority)
 {
     spw->say();
@@ -72,6 +80,20 @@ int main()
         std::cout << e.what() << '\n';
     }
 
+    // with an error channel instead: the Widget is only made once there's a
+    // priority to go with it, and a failure is just a value to check
+    int failures = 0;
+    for (int i = 0; i < 10000; ++i) {
+        auto done = computePriorityChecked().map([](int priority) {
+            processWidget(std::make_shared<Widget>(), priority);
+            return priority;
+        });
+        if (!done)
+            ++failures;
+    }
+    std::cout << failures << " failures, last: "
+              << computePriorityChecked().error().message() << '\n';
+
 
     // circumstances where make can't or shouldn't be used
     // 1. none of the make functions permit the specification of custom deleters
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "../common/PerfCounters.hpp"
+
+
+// What a FilterContainer lookup costs: std::find_if over a million ints with
+// a filter taken out of the container, against the same lambda handed to
+// find_if directly, and a million ints run through all eight filters of a
+// container against the eight divisors tested inline. The divisors are
+// captured by value, the way addDivisorFilter should have captured its one.
+//
+// ns/op is per element tested. The rows carry hardware counters per element
+// too (see PerfCounters.hpp): the std::function call is an indirect one the
+// compiler can't inline, which shows up as instructions and branch misses
+// rather than cache misses, since the ints are read in order.
+
+using FilterContainer = std::vector<std::function<bool(int)>>;    // as in t.cpp
+
+constexpr std::size_t elements = 1000000;
+constexpr int noMatch = 1000003;    // prime above every element: scans it all
+
+template<typename F>
+void perfRow(bench::Runner& runner, instrument::PerfCounters& perf,
+             const std::string& name, std::size_t ops, F f)
+{
+    auto r = runner.runBatch(name, ops, [&perf, &f] {
+        auto region = perf.region();
+        f();
+    });
+    instrument::reportPerf(runner, r, perf, ops);
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item31", argc, argv);
+    instrument::PerfCounters perf;
+
+    std::vector<int> vec(elements);
+    for (std::size_t i = 0; i < elements; ++i)
+        vec[i] = static_cast<int>(i + 1);
+
+    auto divisor = noMatch;
+    auto byDivisor = [divisor](int val) { return val % divisor == 0; };
+    FilterContainer filters;
+    filters.emplace_back(byDivisor);
+
+    perfRow(runner, perf, "find_if: FilterContainer filter", elements, [&] {
+        bench::doNotOptimize(std::find_if(vec.begin(), vec.end(), filters[0]));
+    });
+    perfRow(runner, perf, "find_if: lambda", elements, [&] {
+        bench::doNotOptimize(std::find_if(vec.begin(), vec.end(), byDivisor));
+    });
+
+    FilterContainer eight;
+    for (int d = 2; d <= 9; ++d)
+        eight.emplace_back([d](int val) { return val % d != 0; });
+    perfRow(runner, perf, "8 filters per element: FilterContainer", elements, [&] {
+        std::size_t kept = 0;
+        for (auto v : vec)
+            kept += std::all_of(eight.begin(), eight.end(),
+                                [v](const std::function<bool(int)>& f) { return f(v); });
+        bench::doNotOptimize(kept);
+    });
+    perfRow(runner, perf, "8 filters per element: inline", elements, [&] {
+        std::size_t kept = 0;
+        for (auto v : vec) {
+            bool all = true;
+            for (int d = 2; d <= 9 && all; ++d)
+                all = v % d != 0;
+            kept += all;
+        }
+        bench::doNotOptimize(kept);
+    });
+
+    return runner.finish();
+}
@@ -0,0 +1,127 @@
+#ifndef __CALLABLE__H__
+#define __CALLABLE__H__
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+// Two ways to hold a callable without std::function's cost.
+//
+// SomeCompilerGeneratedClassName in t.cpp keeps its callable in a
+// std::function<T(T&&)>: every call goes through a pointer the optimizer can
+// rarely see through, and the callable may be copied to the heap. The real
+// closure class the compiler generates for a lambda knows the exact type of
+// everything it holds, and its operator() is an ordinary (template) member
+// that inlines. Closure<F> is that: F is stored as itself, and operator() is
+// a template forwarding its arguments to it as they came, so
+//
+//   auto c = makeClosure(multi_by_10);
+//   c(10);
+//
+// compiles to what multi_by_10(10) does ('make codegen' checks the two
+// produce the same instructions; the bench times them).
+//
+// Where the type has to be erased, say a function taking "any callable
+// int(int)" that can't be a template, function_ref<R(Args...)> is a pointer to
+// the callable and a pointer to a function calling it: two words, no
+// allocation, no copy. It doesn't own what it refers to, so like a
+// std::string_view it must not outlive it: fine as a parameter, a mistake as
+// a member or as what a function returns, when made from a temporary.
+template<typename F>
+class Closure {
+public:
+    explicit Closure(F f) : func(std::move(f)) {}
+
+    template<typename... Args>
+    decltype(auto) operator()(Args&&... args) const
+    {
+        return func(std::forward<Args>(args)...);
+    }
+
+    // for a mutable lambda, or anything else whose operator() isn't const
+    template<typename... Args>
+    decltype(auto) operator()(Args&&... args)
+    {
+        return func(std::forward<Args>(args)...);
+    }
+
+private:
+    F func;
+};
+
+template<typename F>
+Closure<std::decay_t<F>> makeClosure(F&& f)
+{
+    return Closure<std::decay_t<F>>(std::forward<F>(f));
+}
+
+
+template<typename Signature>
+class function_ref;
+
+template<typename R, typename... Args>
+class function_ref<R(Args...)> {
+public:
+    // Anything callable as R(Args...) other than another function_ref. A
+    // function is referred to by its own address, anything else (a function
+    // pointer included) by the address of the object.
+    template<typename F,
+             typename = std::enable_if_t<
+                 !std::is_same<std::decay_t<F>, function_ref>::value &&
+                 (std::is_void<R>::value ||
+                  std::is_convertible<std::result_of_t<F&(Args...)>, R>::value)>>
+    function_ref(F&& f) noexcept
+        : object(erase(std::addressof(f))),
+          callback(&invoke<std::remove_reference_t<F>>)
+    {}
+
+    R operator()(Args... args) const
+    {
+        return callback(object, std::forward<Args>(args)...);
+    }
+
+private:
+    // functions can't go through a void*, everything else can
+    union Object {
+        void* obj;
+        void (*fn)();
+    };
+
+    template<typename T>
+    static Object erase(T* p) noexcept
+    {
+        Object o;
+        o.obj = const_cast<void*>(static_cast<const volatile void*>(p));
+        return o;
+    }
+    template<typename Fn, typename... A>
+    static Object erase(Fn (*p)(A...)) noexcept
+    {
+        Object o;
+        o.fn = reinterpret_cast<void (*)()>(p);
+        return o;
+    }
+
+    template<typename T>
+    static R invoke(Object o, Args... args)
+    {
+        return call<T>(o, std::is_function<T>(), std::forward<Args>(args)...);
+    }
+    template<typename T>
+    static R call(Object o, std::false_type, Args... args)
+    {
+        return (*static_cast<T*>(o.obj))(std::forward<Args>(args)...);
+    }
+    template<typename T>
+    static R call(Object o, std::true_type, Args... args)
+    {
+        return reinterpret_cast<T*>(o.fn)(std::forward<Args>(args)...);
+    }
+
+    Object object;
+    R (*callback)(Object, Args...);
+};
+
+#endif // __CALLABLE__H__
@@ -0,0 +1,148 @@
+#ifndef __LAZY__H__
+#define __LAZY__H__
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// Element-wise chains of generic lambdas over arrays, evaluated in one loop.
+//
+// Applying multi_by_10 and two more steps to a million floats the obvious way
+// (std::transform into a new vector per step) writes and reads back a whole
+// temporary array per step. Here each step only records the lambda:
+//
+//   auto e = lazy(v).map(multi_by_10)
+//                   .map([](auto&& x) { return g(std::forward<decltype(x)>(x)); })
+//                   .zip(w, std::plus<>());
+//   std::vector<float> out = e.evaluate();    // or e.evaluateInto(p)
+//
+// and nothing runs until evaluate(), which computes every element through the
+// whole chain in a single pass: one loop, every lambda inlined into it, no
+// temporaries, so the compiler can vectorize it (clang does at -O2; GCC 12 at
+// -O3, as for Parallel.hpp's loops).
+//
+// Each step passes what the one before returned straight to the next lambda,
+// so a generic lambda taking auto&& sees the value category it would have had
+// in a direct call: source elements as const lvalues, results of a previous
+// step as rvalues, and std::forward<decltype(x)>(x) does the right thing
+// with either. Steps should return by value (or a reference into a source):
+// a reference to their argument would dangle once the step returns.
+//
+// An expression holds its sources by pointer and its lambdas by value, so it
+// may outlive the temporaries it was built from but not the arrays: like a
+// view, build it and evaluate it while they're around.
+template<typename Derived>
+class LazyExpr;
+
+template<typename T>
+class LazySource;
+
+template<typename Src, typename F>
+class LazyMap;
+
+template<typename Lhs, typename Rhs, typename F>
+class LazyZip;
+
+template<typename Derived>
+class LazyExpr {
+public:
+    std::size_t size() const noexcept { return self().size(); }
+
+    template<typename F>
+    LazyMap<Derived, F> map(F f) const
+    {
+        return LazyMap<Derived, F>(self(), std::move(f));
+    }
+
+    // f(this[i], rhs[i]); rhs is another expression or a vector of the same size.
+    template<typename R, typename F>
+    LazyZip<Derived, R, F> zip(const LazyExpr<R>& rhs, F f) const
+    {
+        return LazyZip<Derived, R, F>(self(), static_cast<const R&>(rhs), std::move(f));
+    }
+    template<typename T, typename A, typename F>
+    LazyZip<Derived, LazySource<T>, F> zip(const std::vector<T, A>& rhs, F f) const
+    {
+        return zip(LazySource<T>(rhs.data(), rhs.size()), std::move(f));
+    }
+
+    // Writes the n = size() results to out[0], ..., out[n - 1], in one loop.
+    template<typename T>
+    void evaluateInto(T* out) const
+    {
+        const auto& e = self();
+        auto n = e.size();
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = e[i];
+    }
+
+    auto evaluate() const
+    {
+        std::vector<std::decay_t<decltype(self()[0])>> out(size());
+        evaluateInto(out.data());
+        return out;
+    }
+
+private:
+    const Derived& self() const noexcept { return static_cast<const Derived&>(*this); }
+};
+
+template<typename T>
+class LazySource : public LazyExpr<LazySource<T>> {
+public:
+    LazySource(const T* p, std::size_t n) noexcept : data(p), count(n) {}
+
+    std::size_t size() const noexcept { return count; }
+    const T& operator[](std::size_t i) const noexcept { return data[i]; }
+
+private:
+    const T* data;
+    std::size_t count;
+};
+
+template<typename Src, typename F>
+class LazyMap : public LazyExpr<LazyMap<Src, F>> {
+public:
+    LazyMap(const Src& s, F f) : src(s), func(std::move(f)) {}
+
+    std::size_t size() const noexcept { return src.size(); }
+    decltype(auto) operator[](std::size_t i) const { return func(src[i]); }
+
+private:
+    Src src;
+    F func;
+};
+
+template<typename Lhs, typename Rhs, typename F>
+class LazyZip : public LazyExpr<LazyZip<Lhs, Rhs, F>> {
+public:
+    LazyZip(const Lhs& l, const Rhs& r, F f) : lhs(l), rhs(r), func(std::move(f))
+    {
+        assert(lhs.size() == rhs.size());
+    }
+
+    std::size_t size() const noexcept { return lhs.size(); }
+    decltype(auto) operator[](std::size_t i) const { return func(lhs[i], rhs[i]); }
+
+private:
+    Lhs lhs;
+    Rhs rhs;
+    F func;
+};
+
+template<typename T, typename A>
+LazySource<T> lazy(const std::vector<T, A>& v) noexcept
+{
+    return LazySource<T>(v.data(), v.size());
+}
+
+template<typename T>
+LazySource<T> lazy(const T* p, std::size_t n) noexcept
+{
+    return LazySource<T>(p, n);
+}
+
+#endif // __LAZY__H__
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "Callable.hpp"
+#include "Lazy.hpp"
+
+
+// The cost of a call through each way of holding multi_by_10: the lambda
+// called directly, a Closure, a function_ref parameter and a std::function
+// parameter (what SomeCompilerGeneratedClassName holds). Each row sums
+// f(x) over a million ints; ns/op is per call.
+//
+// Direct and Closure calls inline, and the loop vectorizes: they should
+// match ('make codegen' checks they're the same instructions). The two
+// type-erased ones are an indirect call per element, which the optimizer
+// only removes when it can see which callable they were made from, so
+// they're taken through functions that aren't templates, as they would be
+// in real code.
+//
+// Then chains of N generic lambdas over a million floats: materialized, one
+// std::transform into a new vector per step, against a Lazy.hpp chain
+// evaluated into one output in a single loop. ns/op is per element, for the
+// whole chain.
+
+constexpr std::size_t elements = 1000000;
+
+auto multi_by_10 = [](auto x) { return x * 10; };
+
+template<typename F>
+long long sumOf(const std::vector<int>& v, const F& f)
+{
+    long long sum = 0;
+    for (auto x : v)
+        sum += f(x);
+    return sum;
+}
+
+long long sumThrough(const std::vector<int>& v, function_ref<int(int)> f)
+{
+    return sumOf(v, f);
+}
+
+long long sumThrough(const std::vector<int>& v, const std::function<int(int)>& f)
+{
+    return sumOf(v, f);
+}
+
+auto step = [](auto&& x) { return std::forward<decltype(x)>(x) * 1.0001f + 0.5f; };
+
+template<std::size_t N>
+struct Chain {
+    template<typename E>
+    static auto build(const E& e) { return Chain<N - 1>::build(e.map(step)); }
+};
+
+template<>
+struct Chain<0> {
+    template<typename E>
+    static E build(const E& e) { return e; }
+};
+
+template<std::size_t N>
+void chainRows(bench::Runner& runner, const std::vector<float>& in)
+{
+    auto name = std::to_string(N) + "-stage chain: ";
+    runner.runBatch(name + "materialized", in.size(), [&in] {
+        std::vector<float> cur(in.size());
+        std::transform(in.begin(), in.end(), cur.begin(), step);
+        for (std::size_t s = 1; s < N; ++s) {
+            std::vector<float> next(cur.size());
+            std::transform(cur.begin(), cur.end(), next.begin(), step);
+            cur = std::move(next);
+        }
+        bench::doNotOptimize(cur.data());
+    });
+    runner.runBatch(name + "fused", in.size(), [&in] {
+        auto out = Chain<N>::build(lazy(in)).evaluate();
+        bench::doNotOptimize(out.data());
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item33", argc, argv);
+
+    std::vector<int> v(elements);
+    for (std::size_t i = 0; i < elements; ++i)
+        v[i] = static_cast<int>(i % 1000);
+
+    runner.runBatch("call: direct lambda", elements, [&v] {
+        bench::doNotOptimize(sumOf(v, multi_by_10));
+    });
+    auto closure = makeClosure(multi_by_10);
+    runner.runBatch("call: Closure", elements, [&v, &closure] {
+        bench::doNotOptimize(sumOf(v, closure));
+    });
+    runner.runBatch("call: function_ref", elements, [&v] {
+        bench::doNotOptimize(sumThrough(v, function_ref<int(int)>(multi_by_10)));
+    });
+    std::function<int(int)> stdFunction(multi_by_10);
+    runner.runBatch("call: std::function", elements, [&v, &stdFunction] {
+        bench::doNotOptimize(sumThrough(v, stdFunction));
+    });
+
+    std::vector<float> in(elements);
+    for (std::size_t i = 0; i < elements; ++i)
+        in[i] = static_cast<float>(i % 1000);
+    chainRows<1>(runner, in);
+    chainRows<2>(runner, in);
+    chainRows<4>(runner, in);
+    chainRows<8>(runner, in);
+
+    return runner.finish();
+}
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <functional>
+#include <vector>
+#include "Callable.hpp"
+#include "Lazy.hpp"
 
 
 // one of the most exciting features of C++14 is generic lambdas -
@@ -23,6 +26,14 @@ private:
     FuncType func;
 };
 
+// ... which pays for std::function on every call. Closure<F> (Callable.hpp)
+// keeps the callable's own type instead, the way the real closure class does.
+
+int applyTwice(function_ref<int(int)> f, int x)
+{
+    return f(f(x));
+}
+
 
 template<typename T>
 T dummy(T&& para)
@@ -50,9 +61,32 @@ int main()
     );
     std::cout << "dummy simulated class returns: " << my_Functor(10) << '\n';
 
+    // generic like the lambda's own operator(), and inlined like it
+    auto closure = makeClosure(multi_by_10);
+    std::cout << "Closure returns: " << closure(10) << ", " << closure(2.5) << '\n';
+    auto counter = makeClosure([n = 0]() mutable { return ++n; });
+    counter();
+    std::cout << "mutable Closure returns: " << counter() << '\n';
+    std::cout << "through function_ref: " << applyTwice(multi_by_10, 10) << ", "
+              << applyTwice(dummy<int>, 10) << '\n';
+
     [](auto&& param){
         std::cout << "generic lambda\n";
         print_Widget(std::forward<decltype(param)>(param));
     }(Widget{100});
 
+    // generic lambdas chained over arrays, run as one loop by evaluate(); the
+    // first map's results reach the second lambda as rvalues, so dummy<int>
+    // is what it calls, as it would be for dummy(multi_by_10(x))
+    std::vector<int> v {1, 2, 3, 4, 5};
+    std::vector<int> w {5, 4, 3, 2, 1};
+    auto chain = lazy(v)
+        .map(multi_by_10)
+        .map([](auto&& x) { return dummy(std::forward<decltype(x)>(x)); })
+        .zip(w, [](auto&& a, auto&& b) { return std::forward<decltype(a)>(a) + b; });
+    std::cout << "lazy chain:";
+    for (auto x : chain.evaluate())
+        std::cout << ' ' << x;
+    std::cout << '\n';
+
 }
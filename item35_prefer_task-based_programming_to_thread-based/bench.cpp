@@ -0,0 +1,145 @@
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "../common/Expected.hpp"
+#include "../common/Task.hpp"
+
+
+// The cost of running one tiny task and getting its result back: a
+// std::thread plus join, std::async with std::launch::async plus get, and
+// std::async with the default policy, which may run the task deferred.
+//
+// Then many tasks at once, as coroutine Tasks on an Executor with 4 workers
+// against std::async(launch::async): 100k tasks that just compute, and 100k
+// that each sleep 1ms first. Every std::async task is a thread, so those run
+// 10k tasks, at most 1000 alive at a time, to stay inside thread limits;
+// ns/op is per task either way.
+//
+// And a failing task's error coming back through a future: thrown and
+// rethrown by get(), against returned as an Expected, both with the
+// std::async(launch::async) round trip and with std::async(launch::deferred),
+// where there's no thread and the error channel is most of the cost.
+
+int doAsyncWork(int x)
+{
+    return x;
+}
+
+int doAsyncWorkWithException(int)
+{
+    throw std::runtime_error("something wrong");
+}
+
+Expected<int> doAsyncWorkChecked(int)
+{
+    return makeUnexpected(std::errc::value_too_large);
+}
+
+void failingRows(bench::Runner& runner, std::launch policy, const std::string& name)
+{
+    runner.run("failing task, " + name + ": get() rethrows", [policy] {
+        int ret;
+        try {
+            ret = std::async(policy, doAsyncWorkWithException, 10).get();
+        } catch (const std::runtime_error&) {
+            ret = -1;
+        }
+        bench::doNotOptimize(ret);
+    });
+    runner.run("failing task, " + name + ": Expected", [policy] {
+        bench::doNotOptimize(std::async(policy, doAsyncWorkChecked, 10).get().value_or(-1));
+    });
+}
+
+constexpr std::size_t coroTasks = 100000;
+constexpr std::size_t asyncTasks = 10000;
+constexpr std::size_t asyncWave = 1000;
+constexpr auto nap = std::chrono::milliseconds(1);
+
+coro::Task<int> computeTask(coro::Executor& ex, int x)
+{
+    co_await ex.schedule();
+    co_return doAsyncWork(x);
+}
+
+coro::Task<int> sleepyTask(coro::Executor& ex, int x)
+{
+    co_await ex.sleepFor(nap);
+    co_return doAsyncWork(x);
+}
+
+template<typename MakeTask>
+long long runCoroutines(coro::Executor& ex, MakeTask make)
+{
+    std::vector<coro::Task<int>> tasks;
+    tasks.reserve(coroTasks);
+    for (std::size_t i = 0; i < coroTasks; ++i)
+        tasks.push_back(make(ex, static_cast<int>(i)));
+    long long sum = 0;
+    for (auto v : coro::syncWait(coro::whenAll(std::move(tasks))))
+        sum += v;
+    return sum;
+}
+
+template<typename F>
+long long runAsync(F f)
+{
+    long long sum = 0;
+    std::vector<std::future<int>> futs;
+    for (std::size_t i = 0; i < asyncTasks; i += asyncWave) {
+        for (std::size_t j = i; j < i + asyncWave; ++j)
+            futs.push_back(std::async(std::launch::async, f, static_cast<int>(j)));
+        for (auto& fut : futs)
+            sum += fut.get();
+        futs.clear();
+    }
+    return sum;
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item35", argc, argv);
+
+    runner.run("std::thread + join", [] {
+        int ret = 0;
+        std::thread t([&ret] { ret = doAsyncWork(10); });
+        t.join();
+        bench::doNotOptimize(ret);
+    });
+    runner.run("std::async(launch::async) + get", [] {
+        auto fut = std::async(std::launch::async, doAsyncWork, 10);
+        auto ret = fut.get();
+        bench::doNotOptimize(ret);
+    });
+    runner.run("std::async(default policy) + get", [] {
+        auto fut = std::async(doAsyncWork, 10);
+        auto ret = fut.get();
+        bench::doNotOptimize(ret);
+    });
+
+    failingRows(runner, std::launch::async, "launch::async");
+    failingRows(runner, std::launch::deferred, "launch::deferred");
+
+    coro::Executor ex(4);
+    runner.runBatch("100k coroutine tasks, 4 workers", coroTasks, [&] {
+        bench::doNotOptimize(runCoroutines(ex, computeTask));
+    });
+    runner.runBatch("10k std::async tasks", asyncTasks, [&] {
+        bench::doNotOptimize(runAsync(doAsyncWork));
+    });
+    runner.runBatch("100k coroutine tasks sleeping 1ms, 4 workers", coroTasks, [&] {
+        bench::doNotOptimize(runCoroutines(ex, sleepyTask));
+    });
+    runner.runBatch("10k std::async tasks sleeping 1ms", asyncTasks, [&] {
+        bench::doNotOptimize(runAsync([](int x) {
+            std::this_thread::sleep_for(nap);
+            return doAsyncWork(x);
+        }));
+    });
+
+    return runner.finish();
+}
@@ -2,6 +2,8 @@
 #include <thread>
 #include <iostream>
 #include <exception>
+#include "../common/Expected.hpp"
+#include "../common/Task.hpp"
 
 int doAsyncWork(int x)
 {
@@ -15,6 +17,30 @@ int doAsyncWorkWithException(int x)
     return x;
 }
 
+// The same failure returned instead of thrown: the future carries an
+// Expected, get() never rethrows, and the next step is chained with map.
+Expected<int> doAsyncWorkChecked(int x)
+{
+    if (x > 10)
+        return makeUnexpected(std::errc::value_too_large);
+    return x;
+}
+
+// The same work as coroutine tasks: no thread of their own, they run on an
+// executor's workers, and exceptions come out of co_await (or syncWait) just
+// like they come out of get().
+coro::Task<int> doAsyncWorkTask(coro::Executor& ex, int x)
+{
+    co_await ex.schedule();
+    co_return doAsyncWork(x);
+}
+
+coro::Task<int> doAsyncWorkWithExceptionTask(coro::Executor& ex, int x)
+{
+    co_await ex.schedule();
+    co_return doAsyncWorkWithException(x);
+}
+
 int main()
 {
     //thread-based, no straight forward way to get result value
@@ -42,4 +68,23 @@ int main()
     } catch (const std::runtime_error& except) {
         std::cout << except.what() << '\n';
     }
+
+    //task-based, with the error in the result instead of an exception
+    auto fut3 = std::async(doAsyncWorkChecked, 100);
+    auto ret3 = fut3.get().map([](int v) { return v * 2; });
+    if (ret3)
+        std::cout << "get result from future: " << *ret3 << '\n';
+    else
+        std::cout << ret3.error().message() << '\n';
+
+    //coroutine task-based
+    coro::Executor ex(2);
+    auto ret4 = coro::syncWait(doAsyncWorkTask(ex, 10));
+    std::cout << "get result from task: " << ret4 << '\n';
+    try {
+        auto ret5 = coro::syncWait(doAsyncWorkWithExceptionTask(ex, 100));
+        std::cout << "get result from task: " << ret5 << '\n';
+    } catch (const std::runtime_error& except) {
+        std::cout << except.what() << '\n';
+    }
 }
@@ -0,0 +1,273 @@
+#ifndef __EVENT_FUTURE__H__
+#define __EVENT_FUTURE__H__
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../common/Trace.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+
+// Futures that say when they're done instead of waiting to be asked.
+//
+// main's wait_for loops find out late: f3's loop looks once a second, f4's
+// every five, and each thread doing that is a thread spent re-checking. An
+// EventFuture carries an eventfd that becomes readable the moment its value
+// (or exception) is stored, so a CompletionLoop can hand thousands of them to
+// one epoll_wait and run a callback for each as it completes:
+//
+//   CompletionLoop loop;
+//   auto fut = eventAsync(work, arg);         // like realAsync14
+//   loop.watch(fut, [&fut] { use(fut.get()); });
+//   while (loop.pending())
+//       loop.poll();
+//
+// The eventfd is written after the value is stored, so get() never blocks
+// once the fd is readable, and it's never read back: it stays readable, and
+// any number of loops, or plain poll(2), can watch the same future.
+//
+// EventPromise is the promise end, for completions that don't come from a
+// thread of their own. eventAsync runs the callable on a std::async thread,
+// and like a std::async future, that EventFuture's destructor waits for it.
+//
+// Linux only. Errors from the system calls are thrown as std::system_error.
+class EventFd {
+public:
+    EventFd() : fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    {
+        if (fd < 0)
+            throwErrno("eventfd");
+    }
+    EventFd(const EventFd&) = delete;
+    EventFd& operator=(const EventFd&) = delete;
+    ~EventFd() { close(fd); }
+
+    int get() const noexcept { return fd; }
+
+    void signal() noexcept
+    {
+        std::uint64_t one = 1;
+        // can only fail if the counter would overflow, and one write per
+        // completion is far from that
+        while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR)
+            ;
+    }
+
+    [[noreturn]] static void throwErrno(const char* what)
+    {
+        throw std::system_error(errno, std::system_category(), what);
+    }
+
+private:
+    int fd;
+};
+
+
+template<typename T>
+class EventPromise;
+
+template<typename T>
+class EventFuture {
+public:
+    EventFuture() noexcept = default;
+    EventFuture(EventFuture&&) noexcept = default;
+    EventFuture& operator=(EventFuture&&) noexcept = default;
+
+    // Readable once the future is ready. Watch it, don't read it.
+    int fd() const noexcept { return event->get(); }
+
+    bool valid() const noexcept { return result.valid(); }
+    bool ready() const
+    {
+        return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    void wait() const
+    {
+        TRACE_SPAN("EventFuture::wait");
+        result.wait();
+    }
+    template<typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& d) const
+    {
+        return result.wait_for(d);
+    }
+    T get()
+    {
+        TRACE_SPAN("EventFuture::get");
+        return result.get();
+    }
+
+private:
+    template<typename> friend class EventPromise;
+    template<typename F, typename... Args> friend auto eventAsync(F&&, Args&&...);
+
+    EventFuture(std::future<T> r, std::shared_ptr<EventFd> e) noexcept
+        : event(std::move(e)), result(std::move(r))
+    {}
+
+    std::shared_ptr<EventFd> event;
+    std::future<T> result;
+    std::future<void> task;     // eventAsync's thread; its destructor waits
+};
+
+template<typename T>
+class EventPromise {
+public:
+    EventPromise() : event(std::make_shared<EventFd>()) {}
+    EventPromise(EventPromise&&) noexcept = default;
+    EventPromise& operator=(EventPromise&& rhs) noexcept
+    {
+        finish();
+        promise = std::move(rhs.promise);
+        event = std::move(rhs.event);
+        signalled = rhs.signalled;
+        return *this;
+    }
+    // Breaks the promise if nothing was set, and says so on the fd, so a
+    // watcher wakes up and get() throws future_error(broken_promise).
+    ~EventPromise() { finish(); }
+
+    EventFuture<T> get_future() { return EventFuture<T>(promise.get_future(), event); }
+
+    template<typename... U>
+    void set_value(U&&... v)
+    {
+        promise.set_value(std::forward<U>(v)...);
+        signalled = true;
+        event->signal();
+    }
+    void set_exception(std::exception_ptr e)
+    {
+        promise.set_exception(std::move(e));
+        signalled = true;
+        event->signal();
+    }
+
+private:
+    void finish() noexcept
+    {
+        if (!event || signalled)
+            return;
+        promise = std::promise<T>();  // abandons the old state: broken_promise
+        event->signal();
+    }
+
+    std::promise<T> promise;
+    std::shared_ptr<EventFd> event;
+    bool signalled { false };
+};
+
+// realAsync14 with an EventFuture: runs f(args...) on a new thread
+// (std::launch::async), its result or exception goes to the future, and the
+// future's fd becomes readable right after.
+template<typename F, typename... Args>
+auto eventAsync(F&& f, Args&&... args)
+{
+    using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+    EventPromise<R> promise;
+    auto fut = promise.get_future();
+    fut.task = std::async(std::launch::async,
+        [p = std::move(promise)](auto&& fn, auto&&... fnArgs) mutable {
+            TRACE_SPAN("eventAsync task");
+            try {
+                if constexpr (std::is_void_v<R>) {
+                    std::invoke(std::move(fn), std::move(fnArgs)...);
+                    p.set_value();
+                } else {
+                    p.set_value(std::invoke(std::move(fn), std::move(fnArgs)...));
+                }
+            } catch (...) {
+                p.set_exception(std::current_exception());
+            }
+        },
+        std::forward<F>(f), std::forward<Args>(args)...);
+    return fut;
+}
+
+
+// One epoll instance and a callback per watched future. poll() waits until
+// at least one watched future is ready (or the timeout passes), runs the
+// callbacks of all that are, and forgets them. Callbacks run on the thread
+// calling poll(), and may watch more futures.
+class CompletionLoop {
+public:
+    CompletionLoop() : ep(epoll_create1(EPOLL_CLOEXEC))
+    {
+        if (ep < 0)
+            EventFd::throwErrno("epoll_create1");
+    }
+    CompletionLoop(const CompletionLoop&) = delete;
+    CompletionLoop& operator=(const CompletionLoop&) = delete;
+    ~CompletionLoop() { close(ep); }
+
+    // fut must stay alive, and not be watched twice, until its callback ran.
+    template<typename T, typename F>
+    void watch(const EventFuture<T>& fut, F&& onReady)
+    {
+        watchFd(fut.fd(), std::forward<F>(onReady));
+    }
+
+    void watchFd(int fd, std::function<void()> onReady)
+    {
+        epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) < 0)
+            EventFd::throwErrno("epoll_ctl");
+        callbacks.emplace(fd, std::move(onReady));
+    }
+
+    std::size_t pending() const noexcept { return callbacks.size(); }
+
+    // A negative timeout waits as long as it takes. Returns the number of
+    // callbacks run; 0 after a timeout, or with nothing pending.
+    std::size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1))
+    {
+        if (callbacks.empty())
+            return 0;
+        events.resize(std::min<std::size_t>(callbacks.size(), maxEvents));
+        int n;
+        {
+            TRACE_SPAN("CompletionLoop epoll_wait");
+            do {
+                n = epoll_wait(ep, events.data(), static_cast<int>(events.size()),
+                               static_cast<int>(timeout.count()));
+            } while (n < 0 && errno == EINTR);
+        }
+        if (n < 0)
+            EventFd::throwErrno("epoll_wait");
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+            auto it = callbacks.find(fd);
+            auto onReady = std::move(it->second);
+            callbacks.erase(it);
+            TRACE_SPAN("CompletionLoop callback");
+            onReady();
+        }
+        return static_cast<std::size_t>(n);
+    }
+
+private:
+    enum : std::size_t { maxEvents = 256 };
+
+    int ep;
+    std::unordered_map<int, std::function<void()>> callbacks;
+    std::vector<epoll_event> events;
+};
+
+#endif // __EVENT_FUTURE__H__
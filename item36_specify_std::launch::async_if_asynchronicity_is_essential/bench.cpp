@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "Parallel.hpp"
+#if defined(__linux__)
+#include <time.h>
+#include "EventFuture.hpp"
+#endif
+
+
+// main's element-wise multiply, v *= 10, at 10^5 to 10^8 elements: the way
+// main did it, one std::for_each inside one std::async, against parallel_for
+// on 1, 2, 4 and 8 threads with the grain tuned, and on 4 threads with a
+// fixed grain of 1024 elements to show what tuning saves. Then
+// parallel_transform into a second vector (float out of unsigned), which is
+// bound by memory bandwidth sooner. ns/op is per element.
+//
+// More threads than cores only add overhead, so rows past the machine's core
+// count show that cost rather than any speedup.
+//
+// Then how soon a finished task is noticed (Linux only). A setter thread
+// completes EventPromises one at a time, 100us apart, in random order, and
+// notes when; the detecting thread notes when it sees each one:
+//   - main's loops: wait_for(100ms) until ready (f2), and wait_for(0) then
+//     sleep (f3, f4), with the sleep cut from 1-5s to 1ms
+//   - a CompletionLoop, epoll_wait on every future's eventfd
+// once with one task outstanding at a time, once with 1000. Besides ns/op
+// (wall time per completion, mostly the setter's gaps), each row records
+// the mean detection latency and the detecting thread's CPU time per
+// completion.
+
+#if defined(__linux__)
+using Clock = std::chrono::steady_clock;
+using Futures = std::vector<EventFuture<int>>;
+using Stamps = std::vector<Clock::time_point>;
+
+constexpr auto completionGap = std::chrono::microseconds(100);
+constexpr auto pollSleep = std::chrono::milliseconds(1);
+
+double threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+struct Detection {
+    double latencyNs { 0 };
+    double cpuNs { 0 };
+    std::size_t count { 0 };
+};
+
+// One round: outstanding futures, completed in random order by another
+// thread, detected here by detect(futures, seenAt).
+template<typename Detect>
+void detectRound(std::size_t outstanding, Detect detect, Detection& d)
+{
+    std::vector<EventPromise<int>> promises(outstanding);
+    Futures futures;
+    for (auto& p : promises)
+        futures.push_back(p.get_future());
+    std::vector<std::size_t> order(outstanding);
+    for (std::size_t i = 0; i < outstanding; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    Stamps setAt(outstanding), seenAt(outstanding);
+
+    std::thread setter([&] {
+        for (auto k : order) {
+            std::this_thread::sleep_for(completionGap);
+            setAt[k] = Clock::now();
+            promises[k].set_value(static_cast<int>(k));
+        }
+    });
+    auto cpu = threadCpuNs();
+    detect(futures, seenAt);
+    d.cpuNs += threadCpuNs() - cpu;
+    setter.join();
+    for (std::size_t k = 0; k < outstanding; ++k)
+        d.latencyNs += std::chrono::duration<double, std::nano>(seenAt[k] - setAt[k]).count();
+    d.count += outstanding;
+}
+
+// f2's loop; only sensible with one future, or in completion order
+void waitForLoop(Futures& futures, Stamps& seenAt)
+{
+    using namespace std::literals;
+    for (std::size_t k = 0; k < futures.size(); ++k) {
+        while (futures[k].wait_for(100ms) != std::future_status::ready)
+            ;
+        seenAt[k] = Clock::now();
+    }
+}
+
+// f3's and f4's: look at everything, then sleep
+void sleepPoll(Futures& futures, Stamps& seenAt)
+{
+    std::vector<bool> seen(futures.size());
+    std::size_t remaining = futures.size();
+    for (;;) {
+        for (std::size_t k = 0; k < futures.size(); ++k) {
+            if (!seen[k] && futures[k].ready()) {
+                seenAt[k] = Clock::now();
+                seen[k] = true;
+                --remaining;
+            }
+        }
+        if (remaining == 0)
+            return;
+        std::this_thread::sleep_for(pollSleep);
+    }
+}
+
+void completionLoop(Futures& futures, Stamps& seenAt)
+{
+    CompletionLoop loop;
+    for (std::size_t k = 0; k < futures.size(); ++k)
+        loop.watch(futures[k], [&seenAt, k] { seenAt[k] = Clock::now(); });
+    while (loop.pending())
+        loop.poll();
+}
+
+template<typename Detect>
+void detectionRow(bench::Runner& runner, const std::string& name, std::size_t rounds,
+                  std::size_t outstanding, Detect detect)
+{
+    Detection d;
+    auto r = runner.runBatch(name, rounds * outstanding, [&] {
+        for (std::size_t i = 0; i < rounds; ++i)
+            detectRound(outstanding, detect, d);
+    });
+    if (r && d.count) {
+        runner.counter(r, "mean detection latency us", d.latencyNs / d.count / 1000);
+        runner.counter(r, "detector cpu us per completion", d.cpuNs / d.count / 1000);
+    }
+}
+
+void detectionRows(bench::Runner& runner)
+{
+    detectionRow(runner, "1 task: wait_for(100ms) loop", 100, 1, waitForLoop);
+    detectionRow(runner, "1 task: wait_for(0) + sleep 1ms", 100, 1, sleepPoll);
+    detectionRow(runner, "1 task: epoll on eventfd", 100, 1, completionLoop);
+    detectionRow(runner, "1000 tasks: wait_for(0) sweep + sleep 1ms", 1, 1000, sleepPoll);
+    detectionRow(runner, "1000 tasks: CompletionLoop", 1, 1000, completionLoop);
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item36", argc, argv);
+
+    for (std::size_t n : { 100000ul, 1000000ul, 10000000ul, 100000000ul }) {
+        // unsigned: every warmup and rep multiplies the same elements by 10
+        // again, and with int that would soon be signed overflow, undefined
+        // behaviour inside the timed loop; unsigned just wraps
+        std::vector<unsigned> vec(n, 1);
+        std::string size = "n=10^" + std::to_string(static_cast<int>(std::to_string(n).size()) - 1);
+
+        runner.runBatch(size + ": std::for_each in one std::async", n, [&vec] {
+            std::async([&vec](auto i) {
+                std::for_each(vec.begin(), vec.end(), [&i](auto& v) { v *= i; });
+            }, 10).get();
+            bench::doNotOptimize(vec.data());
+        });
+        for (unsigned threads : { 1u, 2u, 4u, 8u }) {
+            runner.runBatch(size + ": parallel_for, " + std::to_string(threads) + (threads == 1 ? " thread" : " threads"), n,
+                            [&vec, threads] {
+                parallel_for(vec.begin(), vec.end(), [](unsigned& v) { v *= 10; },
+                             ParallelOptions{ threads, 0 });
+                bench::doNotOptimize(vec.data());
+            });
+        }
+        runner.runBatch(size + ": parallel_for, 4 threads, grain 1024", n, [&vec] {
+            parallel_for(vec.begin(), vec.end(), [](unsigned& v) { v *= 10; },
+                         ParallelOptions{ 4, 1024 });
+            bench::doNotOptimize(vec.data());
+        });
+
+        std::vector<float> out(n);
+        runner.runBatch(size + ": std::transform", n, [&vec, &out] {
+            std::transform(vec.begin(), vec.end(), out.begin(),
+                           [](unsigned v) { return v * 0.5f; });
+            bench::doNotOptimize(out.data());
+        });
+        runner.runBatch(size + ": parallel_transform, 4 threads", n, [&vec, &out] {
+            parallel_transform(vec.begin(), vec.end(), out.begin(),
+                               [](unsigned v) { return v * 0.5f; }, ParallelOptions{ 4, 0 });
+            bench::doNotOptimize(out.data());
+        });
+    }
+
+#if defined(__linux__)
+    detectionRows(runner);
+#endif
+
+    return runner.finish();
+}
@@ -3,10 +3,19 @@
 #include <vector>
 #include <algorithm>
 #include <iterator>
+#include <string>
 #include <type_traits>
+#include "../common/Expected.hpp"
+#include "../common/Task.hpp"
+#include "../common/Trace.hpp"
+#include "Parallel.hpp"
+#if defined(__linux__)
+#include "EventFuture.hpp"
+#endif
 
 void f()
 {
+    TRACE_SPAN("f");
     using namespace std::literals;
     std::this_thread::sleep_for(1s);
 }
@@ -37,21 +46,47 @@ realAsync14(F&& f, Args&&... args)
 
 int async_work(const std::vector<int>& vec)
 {
+    TRACE_SPAN("async_work");
     std::cout << "from async_work:\n";
     std::copy(vec.begin(), vec.end(), std::ostream_iterator<int>(std::cout, " "));
     std::cout << '\n';
     return *(vec.begin()) + 41; 
 }
 
+// async_work reads the first element whatever the vector holds. This one
+// reports an empty vector as an error, so the future made by realAsync14
+// carries an Expected<int>: no exception to rethrow from get(), and the
+// caller chains on the result.
+Expected<int> checked_async_work(const std::vector<int>& vec)
+{
+    if (vec.empty())
+        return makeUnexpected(std::errc::invalid_argument);
+    return async_work(vec);
+}
+
+// f's one-second nap and async_work as coroutine steps: while sleeping and
+// while waiting for the future, no thread is blocked, the task is just
+// suspended until the executor's timer or future polling resumes it.
+coro::Task<int> napThenWork(coro::Executor& ex)
+{
+    using namespace std::literals;
+    co_await ex.sleepFor(1s);
+    auto fut = realAsync14(async_work, std::vector<int>{1,2,3,4,5});
+    co_return co_await ex.whenReady(std::move(fut));
+}
+
 
 int main()
 {
     using namespace std::literals;
+    TRACE_THREAD_NAME("main");
     std::vector<int> vec {1,2,3,4,5};
 
     // default launch policy is std::launch::async | std::launch::deferred
+    // the multiply itself is split across threads by parallel_for (Parallel.hpp);
+    // for a vector this short it all runs on the thread std::async picked
     auto fut = std::async([&vec](auto i){
-        std::for_each(vec.begin(), vec.end(), [&i](auto& v){
+        parallel_for(vec.begin(), vec.end(), [i](auto& v){
             v *= i;
         });
     }, 10);
@@ -87,9 +122,35 @@ int main()
     }
     // f4 is ready
 
+#if defined(__linux__)
+    // no polling: each task's eventfd becomes readable when it's done, and
+    // one epoll loop reacts to whichever finishes, as it finishes
+    CompletionLoop loop;
+    std::vector<EventFuture<int>> naps;
+    for (int ms : { 300, 100, 200 })
+        naps.push_back(eventAsync([ms] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+            return ms;
+        }));
+    for (auto& nap : naps)
+        loop.watch(nap, [&nap] { std::cout << "task that slept " << nap.get() << "ms is done\n"; });
+    while (loop.pending())
+        loop.poll();
+#endif
+
     auto f5 = realAsync11(async_work, std::vector<int>{1,2,3,4,5});
     std::cout << f5.get() << '\n';
 
     auto f6 = realAsync14(async_work, std::vector<int>{1,2,3,4,5});
     std::cout << f6.get() << '\n';
+
+    auto f7 = realAsync14(checked_async_work, std::vector<int>{});
+    auto r7 = f7.get().map([](int v) { return v * 2; });
+    std::cout << (r7 ? std::to_string(*r7) : "error: " + r7.error().message()) << '\n';
+
+    coro::Executor ex(1);
+    std::cout << coro::syncWait(napThenWork(ex)) << '\n';
+
+    // with 'make trace': the async tasks and the waits for them as a timeline
+    TRACE_WRITE("trace.json");
 }
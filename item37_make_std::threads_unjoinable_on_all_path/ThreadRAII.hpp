@@ -0,0 +1,285 @@
+#ifndef __THREAD_RAII__H__
+#define __THREAD_RAII__H__
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../common/Trace.hpp"
+
+
+// RAII classes are common in the Standard Library. Examples include the STL containers,
+// smart pointers, std::fstream objects and many more. And yet there is no standard RAII
+// class for std::thread objects, perhaps because the Standardization Committee having
+// rejected both join and detach as default options, simply didn't konw what such a class
+// shoud do. Fortunately, it's not difficult to write one yourself. For example, the following
+// class allows callers to specify whether join or detach should be called when a ThreadRAII
+// object is destroyed.
+//
+// Since it owns the thread, it's also the natural place for what native_handle() is
+// for: ThreadRAII::start runs a callable on a new thread that first pins itself to a set
+// of CPUs and names itself (the name shows up in top -H, perf, gdb), so neither the
+// thread nor the memory it touches first drifts across NUMA nodes. Buffers the thread
+// works on go in a NodeBuffer, allocated on the thread's own node (see below).
+//
+// Placement is Linux only; elsewhere, and for CPUs that don't exist, the options are
+// ignored and the thread runs wherever the scheduler puts it.
+struct ThreadOptions {
+    std::string name;           // at most 15 characters are kept
+    std::vector<int> cpus;      // empty: any CPU
+};
+
+class ThreadRAII {
+public:
+    enum class DtorAction { join, detach };
+
+    // because std::thread objects may start runing a function immediately after they are
+    // initialized, it's a good habit to declare them last in a class. That guarantees that
+    // at the time they are constructed, all the data members that precede them have
+    // already been initialized and can therefore be safely accessed by the asynchronously
+    // running thread that corresponds to the std::thread data member.
+    ThreadRAII(std::thread&& t, DtorAction a)
+        : action(a), t(std::move(t)) {}
+
+    // Placement has to happen on the new thread before f runs: set from outside, after
+    // the thread started, f may already have run (and touched memory) somewhere else.
+    template<typename F, typename... Args>
+    static ThreadRAII start(DtorAction a, const ThreadOptions& opts, F&& f, Args&&... args)
+    {
+        std::thread t(
+            [opts](auto&& fn, auto&&... fnArgs) {
+                applyToSelf(opts);
+                TRACE_THREAD_NAME(opts.name.empty() ? "ThreadRAII" : opts.name);
+                TRACE_SPAN("ThreadRAII thread");
+                std::move(fn)(std::move(fnArgs)...);
+            },
+            std::forward<F>(f), std::forward<Args>(args)...);
+        // named from here as well, so whoever looks right after start() sees it
+        setName(t, opts.name);
+        return ThreadRAII(std::move(t), a);
+    }
+
+    // no default move / move assignment operator will be generated when there's user defined
+    // destructor, but for this class, the default move / move assignment is usable. So we can
+    // explictily ask for that using = default;
+    ThreadRAII(ThreadRAII&&) = default;
+    ThreadRAII& operator=(ThreadRAII&&) = default;
+
+    ~ThreadRAII()
+    {
+        if (t.joinable()) {
+            if (action == DtorAction::join) {
+                TRACE_SPAN("ThreadRAII join");
+                t.join();
+            } else {
+                t.detach();
+            }
+        }
+    }
+
+    std::thread& get() { return t; }
+
+    // Pins and names the calling thread; start() does this on the new thread.
+    static void applyToSelf(const ThreadOptions& opts)
+    {
+#if defined(__linux__)
+        if (!opts.cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (auto cpu : opts.cpus)
+                if (cpu >= 0 && cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &set);
+            // fails if none of the CPUs is online; then the thread stays unpinned
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+        if (!opts.name.empty())
+            pthread_setname_np(pthread_self(), opts.name.substr(0, 15).c_str());
+#else
+        (void)opts;
+#endif
+    }
+
+private:
+    static void setName(std::thread& t, const std::string& name)
+    {
+#if defined(__linux__)
+        if (!name.empty())
+            pthread_setname_np(t.native_handle(), name.substr(0, 15).c_str());
+#else
+        (void)t;
+        (void)name;
+#endif
+    }
+
+    DtorAction action;
+    std::thread t;
+};
+
+
+// NUMA nodes, as the kernel numbers them. A machine without NUMA, or any
+// machine that isn't Linux, has one node: 0.
+namespace numa {
+
+inline int nodeCount()
+{
+#if defined(__linux__)
+    // "0", "0-1", "0-3,6": the highest node number counts
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string ranges;
+    if (!(online >> ranges))
+        return 1;
+    int highest = 0, n = 0;
+    for (auto c : ranges) {
+        if (c >= '0' && c <= '9') {
+            n = n * 10 + (c - '0');
+        } else {
+            highest = std::max(highest, n);
+            n = 0;
+        }
+    }
+    return std::max(highest, n) + 1;
+#else
+    return 1;
+#endif
+}
+
+// The node of the CPU the calling thread is on right now; meaningful once
+// the thread is pinned to CPUs of a single node.
+inline int currentNode()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return static_cast<int>(node);
+#endif
+    return 0;
+}
+
+// The CPUs of a node, from its cpulist ("0-7,16-23"); empty if unknown.
+inline std::vector<int> cpusOfNode(int node)
+{
+    std::vector<int> cpus;
+#if defined(__linux__)
+    std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string ranges;
+    if (!(list >> ranges))
+        return cpus;
+    std::size_t pos = 0;
+    while (pos < ranges.size()) {
+        auto comma = ranges.find(',', pos);
+        auto range = ranges.substr(pos, comma == std::string::npos ? std::string::npos
+                                                                   : comma - pos);
+        auto dash = range.find('-');
+        int first = std::stoi(range);
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+        if (comma == std::string::npos)
+            break;
+        pos = comma + 1;
+    }
+#else
+    (void)node;
+#endif
+    return cpus;
+}
+
+} // namespace numa
+
+
+// n elements of T in memory of one NUMA node: mapped, bound to the node with
+// mbind(MPOL_BIND), then touched, so every page is already on that node when
+// the buffer is handed out. NodeBuffer<T>::local(n) uses the calling thread's
+// node; call it from the (pinned) thread that will work on the buffer.
+//
+// With a single node there's nothing to bind; the pages land, as always, on
+// the node of the thread that touches them first. T must be trivial: the
+// elements are zero-filled, not constructed.
+template<typename T>
+class NodeBuffer {
+    static_assert(std::is_trivial<T>::value, "NodeBuffer holds trivial types");
+public:
+    NodeBuffer() noexcept = default;
+
+    NodeBuffer(std::size_t count, int node) : n(count), bytes(count * sizeof(T))
+    {
+        if (bytes == 0)
+            return;
+#if defined(__linux__)
+        auto p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        data_ = static_cast<T*>(p);
+        if (numa::nodeCount() > 1 && node >= 0 &&
+            node < static_cast<int>(sizeof(unsigned long) * 8)) {
+            unsigned long mask = 1UL << node;
+            // best effort: without the permission or the node, the default
+            // first-touch policy still applies
+            syscall(SYS_mbind, p, bytes, MPOL_BIND, &mask, sizeof(mask) * 8 + 1, 0);
+        }
+#else
+        (void)node;
+        data_ = static_cast<T*>(::operator new(bytes));
+#endif
+        // fault every page in now, on the bound node
+        std::fill(reinterpret_cast<unsigned char*>(data_),
+                  reinterpret_cast<unsigned char*>(data_) + bytes, 0);
+    }
+
+    static NodeBuffer local(std::size_t count) { return NodeBuffer(count, numa::currentNode()); }
+
+    NodeBuffer(NodeBuffer&& rhs) noexcept
+        : data_(std::exchange(rhs.data_, nullptr)), n(std::exchange(rhs.n, 0)),
+          bytes(std::exchange(rhs.bytes, 0))
+    {}
+    NodeBuffer& operator=(NodeBuffer&& rhs) noexcept
+    {
+        std::swap(data_, rhs.data_);
+        std::swap(n, rhs.n);
+        std::swap(bytes, rhs.bytes);
+        return *this;
+    }
+    ~NodeBuffer()
+    {
+        if (!data_)
+            return;
+#if defined(__linux__)
+        munmap(data_, bytes);
+#else
+        ::operator delete(data_);
+#endif
+    }
+
+    T* data() noexcept { return data_; }
+    const T* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return n; }
+    T& operator[](std::size_t i) noexcept { return data_[i]; }
+    const T& operator[](std::size_t i) const noexcept { return data_[i]; }
+    T* begin() noexcept { return data_; }
+    T* end() noexcept { return data_ + n; }
+    const T* begin() const noexcept { return data_; }
+    const T* end() const noexcept { return data_ + n; }
+
+private:
+    T* data_ { nullptr };
+    std::size_t n { 0 };
+    std::size_t bytes { 0 };
+};
+
+#endif // __THREAD_RAII__H__
@@ -0,0 +1,138 @@
+#ifndef __TIMER_SERVICE__H__
+#define __TIMER_SERVICE__H__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../common/Trace.hpp"
+
+
+// Delayed work on one shared timer thread.
+//
+// conditionsAreSatisfied starts a thread only to sleep in it, and blocks its
+// caller for the whole nap: a thousand pending conditions are a thousand
+// sleeping threads, each with its stack. Here a pending condition is an
+// entry in a heap ordered by deadline. The timer thread sleeps until the
+// earliest one is due, evaluates it, and stores the result in its future:
+//
+//   auto ok = timers.callAfter(5s, [flag] { return flag != 0; });
+//   ...                                  // the caller isn't blocked
+//   if (ok.get()) ...
+//
+// The callables run on the timer thread, one after the other, so they should
+// be quick: evaluate the condition, don't do the work. An exception thrown
+// by one goes to its future. Entries due at the same time run in the order
+// they were added.
+//
+// The destructor stops the thread without running what's still pending;
+// those futures get std::future_error(broken_promise).
+class TimerService {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerService() : thread([this] { run(); }) {}
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    ~TimerService()
+    {
+        {
+            std::lock_guard<std::mutex> g(m);
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+    template<typename F>
+    auto callAt(Clock::time_point deadline, F&& f)
+    {
+        using R = std::result_of_t<std::decay_t<F>()>;
+        std::packaged_task<R()> task(std::forward<F>(f));
+        auto fut = task.get_future();
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> g(m);
+            earliest = entries.empty() || deadline < entries.top().deadline;
+            // as in TaskGraph: the typed task moves whole into a void one
+            std::packaged_task<void()> run([t = std::move(task)]() mutable { t(); });
+            entries.push(Entry { deadline, nextSeq++, std::move(run) });
+        }
+        // only a new earliest deadline changes how long the thread sleeps
+        if (earliest)
+            cv.notify_one();
+        return fut;
+    }
+
+    template<typename Rep, typename Period, typename F>
+    auto callAfter(const std::chrono::duration<Rep, Period>& delay, F&& f)
+    {
+        return callAt(Clock::now() + std::chrono::duration_cast<Clock::duration>(delay),
+                      std::forward<F>(f));
+    }
+
+    std::size_t pending() const
+    {
+        std::lock_guard<std::mutex> g(m);
+        return entries.size();
+    }
+
+private:
+    struct Entry {
+        Clock::time_point deadline;
+        unsigned long long seq;
+        // mutable: priority_queue only hands out const references, and the
+        // task is moved out of top() right before pop()
+        mutable std::packaged_task<void()> task;
+
+        bool operator>(const Entry& rhs) const
+        {
+            return deadline != rhs.deadline ? deadline > rhs.deadline : seq > rhs.seq;
+        }
+    };
+
+    void run()
+    {
+        TRACE_THREAD_NAME("TimerService");
+        std::unique_lock<std::mutex> lock(m);
+        for (;;) {
+            if (stopping)
+                return;
+            if (entries.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+            auto deadline = entries.top().deadline;
+            if (Clock::now() < deadline) {
+                cv.wait_until(lock, deadline);
+                continue;
+            }
+            auto task = std::move(entries.top().task);
+            entries.pop();
+            lock.unlock();
+            {
+                TRACE_SPAN("TimerService callback");
+                task();
+            }
+            lock.lock();
+        }
+    }
+
+    mutable std::mutex m;
+    std::condition_variable cv;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> entries;
+    unsigned long long nextSeq { 0 };
+    bool stopping { false };
+    // last, so everything it uses is constructed before it starts
+    std::thread thread;
+};
+
+#endif // __TIMER_SERVICE__H__
@@ -0,0 +1,182 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "../common/PerfCounters.hpp"
+#include "ThreadRAII.hpp"
+#include "TimerService.hpp"
+
+
+// What ThreadRAII's placement costs and what it buys.
+//
+// Starting and joining a thread: plain std::thread in a ThreadRAII, against
+// ThreadRAII::start pinning it to node 0's CPUs and naming it.
+//
+// Then a worker pinned to node 0 reading a 64 MiB NodeBuffer, sequentially
+// (ns/op per 8-byte word) and at random (ns/op per read, mostly cache and
+// TLB misses), with the buffer on its own node and on every other node. The
+// remote rows are the penalty NodeBuffer::local avoids. With a single node
+// (this includes every machine that isn't Linux) only the local rows run.
+//
+// Last, 10k conditions pending at once, all due 1s after the first is
+// registered: a std::async(launch::async) thread per condition that sleeps
+// and then evaluates it, as conditionsAreSatisfied does, against one
+// TimerService. ns/op is the cost of registering one; the wait for them to
+// come due is untimed. The counters are the process's threads and resident
+// and virtual memory while all 10k are pending, less what they were before
+// (from /proc/self/status; zero elsewhere).
+//
+// And doWork's scan itself: a million values through the filter, kept ones
+// pushed into a vector, with the filter behind a std::function as doWork
+// takes it and as a template parameter the compiler can inline. These rows
+// carry hardware counters per value scanned (see PerfCounters.hpp), which
+// show whether the indirect call costs instructions, branch misses, or both.
+
+constexpr std::size_t words = 64 * 1024 * 1024 / sizeof(std::uint64_t);
+constexpr std::size_t randomReads = 1 << 22;
+
+void placedRows(bench::Runner& runner, int memNode)
+{
+    std::string where = memNode == 0 ? "local node" : "node " + std::to_string(memNode);
+    // the runner is only used by one thread at a time: main waits in the
+    // ThreadRAII destructor
+    ThreadOptions reader{ "bench-reader", numa::cpusOfNode(0) };
+    ThreadRAII::start(ThreadRAII::DtorAction::join, reader, [&runner, memNode, where] {
+        NodeBuffer<std::uint64_t> buf(words, memNode);
+        for (std::size_t i = 0; i < words; ++i)
+            buf[i] = i;
+        runner.runBatch("sequential sum, buffer on " + where, words, [&buf] {
+            std::uint64_t sum = 0;
+            for (auto v : buf)
+                sum += v;
+            bench::doNotOptimize(sum);
+        });
+        runner.runBatch("random reads, buffer on " + where, randomReads, [&buf] {
+            std::uint64_t sum = 0, x = 88172645463325252ull;
+            for (std::size_t i = 0; i < randomReads; ++i) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                sum += buf[x % words];
+            }
+            bench::doNotOptimize(sum);
+        });
+    });
+}
+
+constexpr std::size_t pendingConditions = 10000;
+constexpr auto conditionDelay = std::chrono::seconds(1);
+
+struct ProcessStatus {
+    double threads { 0 };
+    double rssMiB { 0 };
+    double vmMiB { 0 };
+};
+
+ProcessStatus processStatus()
+{
+    ProcessStatus s;
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    double value;
+    while (status >> key) {
+        if (key == "Threads:" && status >> value)
+            s.threads = value;
+        else if (key == "VmRSS:" && status >> value)
+            s.rssMiB = value / 1024;
+        else if (key == "VmSize:" && status >> value)
+            s.vmMiB = value / 1024;
+    }
+    return s;
+}
+
+// register(flag, deadline) returns a std::future<bool>.
+template<typename Register>
+void pendingRow(bench::Runner& runner, const std::string& name, Register reg)
+{
+    std::vector<std::future<bool>> futures;
+    ProcessStatus before, during;
+    auto drain = [&futures] {
+        for (auto& f : futures)
+            f.get();
+        futures.clear();
+    };
+    auto r = runner.runBatch(name, pendingConditions,
+        [&] {
+            drain();
+            futures.reserve(pendingConditions);
+            before = processStatus();
+        },
+        [&] {
+            auto deadline = std::chrono::steady_clock::now() + conditionDelay;
+            for (std::size_t i = 0; i < pendingConditions; ++i)
+                futures.push_back(reg(static_cast<int>(i & 1), deadline));
+            during = processStatus();
+        });
+    drain();
+    if (r) {
+        runner.counter(r, "threads while pending", during.threads - before.threads);
+        runner.counter(r, "resident MiB while pending", during.rssMiB - before.rssMiB);
+        runner.counter(r, "virtual MiB while pending", during.vmMiB - before.vmMiB);
+    }
+}
+
+constexpr int scanValues = 1000000;    // doWork's maxVal
+
+template<typename Filter>
+void scanRow(bench::Runner& runner, instrument::PerfCounters& perf,
+             const std::string& name, Filter filter)
+{
+    auto r = runner.runBatch(name, scanValues + 1, [&perf, &filter] {
+        auto region = perf.region();
+        std::vector<int> goodVals;
+        for (auto i = 0; i <= scanValues; ++i) {
+            if (filter(i)) goodVals.push_back(i);
+        }
+        bench::doNotOptimize(goodVals.data());
+    });
+    instrument::reportPerf(runner, r, perf, scanValues + 1);
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item37", argc, argv);
+
+    runner.run("thread start + join: std::thread", [] {
+        ThreadRAII t(std::thread([] { bench::doNotOptimize(0); }), ThreadRAII::DtorAction::join);
+    });
+    auto node0 = numa::cpusOfNode(0);
+    runner.run("thread start + join: pinned, named", [&node0] {
+        auto t = ThreadRAII::start(ThreadRAII::DtorAction::join,
+                                   ThreadOptions{ "bench-worker", node0 },
+                                   [] { bench::doNotOptimize(0); });
+    });
+
+    for (int node = 0; node < numa::nodeCount(); ++node)
+        placedRows(runner, node);
+
+    pendingRow(runner, "10k pending conditions: thread each",
+               [](int flag, std::chrono::steady_clock::time_point deadline) {
+        return std::async(std::launch::async, [flag, deadline] {
+            std::this_thread::sleep_until(deadline);
+            return flag != 0;
+        });
+    });
+    TimerService timers;
+    pendingRow(runner, "10k pending conditions: TimerService",
+               [&timers](int flag, TimerService::Clock::time_point deadline) {
+        return timers.callAt(deadline, [flag] { return flag != 0; });
+    });
+
+    instrument::PerfCounters perf;
+    auto filter = [](const auto& i) { return i % 1000 == 0; };
+    scanRow(runner, perf, "doWork scan: std::function filter", std::function<bool(int)>(filter));
+    scanRow(runner, perf, "doWork scan: inlined filter", filter);
+
+    return runner.finish();
+}
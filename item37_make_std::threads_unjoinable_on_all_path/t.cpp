@@ -1,9 +1,13 @@
 #include <thread>
+#include <future>
 #include <functional>
 #include <vector> 
 #include <iterator>
 #include <algorithm>
 #include <iostream>
+#include "../common/Trace.hpp"
+#include "ThreadRAII.hpp"
+#include "TimerService.hpp"
 
 // unjoinable thread includes:
 // 1. default-constructed std::threads
@@ -15,6 +19,7 @@ constexpr auto tenMillion = 1000000;
 
 bool conditionsAreSatisfied(int flag)
 {
+    TRACE_SPAN("conditionsAreSatisfied");
     using namespace std::literals;
     bool ok = false;
     std::thread t([&ok, flag](){
@@ -25,6 +30,23 @@ bool conditionsAreSatisfied(int flag)
     return ok;
 }
 
+// The same check without a thread of its own: the shared timer thread (TimerService.hpp)
+// evaluates it once the 5s are up, and the caller gets a future instead of being blocked,
+// so it can start the check first and do other work until it needs the answer.
+TimerService& sharedTimers()
+{
+    static TimerService timers;
+    return timers;
+}
+
+std::future<bool> conditionsAreSatisfiedAsync(int flag)
+{
+    using namespace std::literals;
+    return sharedTimers().callAfter(5s, [flag](){
+        return flag == 0 ? false : true;
+    });
+}
+
 void performComputation(const std::vector<int>& vec)
 {
     using namespace std::literals;
@@ -60,66 +82,39 @@ bool doWork(std::function<bool(int)> filter, int maxVal = tenMillion)
     return false;
 }
 
-// RAII classes are common in the Standard Library. Examples include the STL containers,
-// smart pointers, std::fstream objects and many more. And yet there is no standard RAII
-// class for std::thread objects, perhaps because the Standardization Committee having
-// rejected both join and detach as default options, simply didn't konw what such a class
-// shoud do. Fortunately, it's not difficult to write one yourself. For example, the following
-// class allows callers to specify whether join or detach should be called when a ThreadRAII 
-// object is destroyed:
-class ThreadRAII {
-public:
-    enum class DtorAction { join, detach };
-
-    // because std::thread objects may start runing a function immediately after they are
-    // initialized, it's a good habit to declare them last in a class. That guarantees that
-    // at the time they are constructed, all the data members that precede them have
-    // already been initialized and can therefore be safely accessed by the asynchronously
-    // running thread that corresponds to the std::thread data member.
-    ThreadRAII(std::thread&& t, DtorAction a)
-        : action(a), t(std::move(t)) {}
-
-    // no default move / move assignment operator will be generated when there's user defined
-    // destructor, but for this class, the default move / move assignment is usable. So we can
-    // explictily ask for that using = default;
-    ThreadRAII(ThreadRAII&&) = default;
-    ThreadRAII& operator=(ThreadRAII&&) = default;
-
-    ~ThreadRAII()
-    {
-        if (t.joinable()) {
-            if (action == DtorAction::join) {
-                t.join();
-            } else {
-                t.detach();
-            }
-        }
-    }
-
-    std::thread& get() { return t; }
-
-private:
-    DtorAction action;
-    std::thread t;
-};
+// ThreadRAII (ThreadRAII.hpp) makes the thread unjoinable on every path out of the
+// scope: its destructor joins or detaches, as asked for when it was constructed.
 
 
 bool doWork2(std::function<bool(int)> filter, int maxVal = tenMillion)
 {
     std::vector<int> goodVals;
 
-    ThreadRAII t(
-        std::thread([&filter, maxVal, &goodVals]{
+    // the 5s start now and run alongside the filtering, not after it
+    auto satisfied = conditionsAreSatisfiedAsync(0);
+
+    // started through ThreadRAII::start, the thread is pinned to CPU 0 and named before
+    // it runs the filter, so it and the goodVals it fills stay on one NUMA node
+    auto t = ThreadRAII::start(
+        ThreadRAII::DtorAction::join,  // RAII action
+        ThreadOptions{ "doWork2", { 0 } },
+        [&filter, maxVal, &goodVals]{
             for (auto i = 0; i <= maxVal; ++i) {
                 if (filter(i)) goodVals.push_back(i);
             }
-        }),
-        ThreadRAII::DtorAction::join  // RAII action
+        }
     );
 
     auto nh = t.get().native_handle();
-
-    if (conditionsAreSatisfied(0)) {
+#if defined(__linux__)
+    char name[16] = {};
+    pthread_getname_np(nh, name, sizeof(name));
+    std::cout << "worker thread: " << name << '\n';
+#else
+    (void)nh;
+#endif
+
+    if (satisfied.get()) {
         t.get().join();
         performComputation(goodVals);
         return true;
@@ -131,10 +126,14 @@ bool doWork2(std::function<bool(int)> filter, int maxVal = tenMillion)
 
 int main()
 {
+    TRACE_THREAD_NAME("main");
     auto filter = [](const auto& i){
         return i % 1000 == 0;
     };
     doWork(filter, tenMillion);
     // even if conditionsAreSatisfied return false, thread is joined before leaving the scope using RAII
     doWork2(filter, tenMillion);
+
+    // with 'make trace': the ThreadRAII and timer threads as a timeline
+    TRACE_WRITE("trace.json");
 }
@@ -0,0 +1,316 @@
+#ifndef __POOLED_FUTURE__H__
+#define __POOLED_FUTURE__H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "../common/Trace.hpp"
+
+
+// A promise/future pair whose shared state comes from a per-thread free
+// list instead of a fresh heap allocation each time.
+//
+// Three things differ from std::promise/std::future:
+//   - the shared state is recycled: the last handle to let go of it puts it
+//     on its thread's free list (up to freeListCap states per thread and
+//     type), and the next PooledPromise made on that thread takes it back.
+//   - no destructor ever blocks. There is no std::async here, so nothing
+//     for a destructor to wait for: the state is reference counted, and
+//     whoever drops the last reference recycles it.
+//   - PooledSharedFuture::get() on a ready state is one acquire load and a
+//     reference to the value. Copies only bump a reference count. One
+//     set_value can be read by any number of threads this way.
+//
+// Waiting for a state that isn't ready spins briefly and then sleeps on the
+// state's condition variable; set_value only touches the mutex when someone
+// is asleep. A PooledPromise destroyed without a value stores a
+// std::future_error(broken_promise), like std::promise.
+//
+// Don't keep these in thread_local objects: a state released while its
+// thread's free list is being destroyed has nowhere to go.
+template<typename T>
+class FutureState {
+    static_assert(!std::is_reference<T>::value && !std::is_void<T>::value,
+                  "FutureState holds a value");
+public:
+    static constexpr std::size_t freeListCap = 256;
+
+    static FutureState* make()
+    {
+        auto& fl = freeList();
+        if (auto s = fl.head) {
+            fl.head = s->nextFree;
+            --fl.size;
+            s->refs.store(1, std::memory_order_relaxed);
+            s->status.store(pending, std::memory_order_relaxed);
+            return s;
+        }
+        return new FutureState;
+    }
+
+    void addRef() noexcept { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        if (status.load(std::memory_order_relaxed) == hasValue)
+            value()->~T();
+        error = nullptr;
+        auto& fl = freeList();
+        if (fl.size < freeListCap) {
+            nextFree = fl.head;
+            fl.head = this;
+            ++fl.size;
+        } else {
+            delete this;
+        }
+    }
+
+    template<typename U>
+    void setValue(U&& v)
+    {
+        claim();
+        try {
+            ::new (&storage) T(std::forward<U>(v));
+        } catch (...) {
+            publish(hasError, std::current_exception());
+            throw;
+        }
+        publish(hasValue, nullptr);
+    }
+
+    void setException(std::exception_ptr e)
+    {
+        claim();
+        publish(hasError, std::move(e));
+    }
+
+    bool ready() const noexcept { return status.load(std::memory_order_acquire) >= hasValue; }
+
+    void wait()
+    {
+        for (int i = 0; i < 64; ++i) {
+            if (ready())
+                return;
+            std::this_thread::yield();
+        }
+        TRACE_SPAN("PooledFuture blocked");
+        std::unique_lock<std::mutex> lock(m);
+        // paired with the fence in publish(): either we see the value, or
+        // the setter sees us waiting
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv.wait(lock, [this] { return ready(); });
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // The value, or the stored exception rethrown. Only once ready().
+    T& get()
+    {
+        if (status.load(std::memory_order_acquire) == hasError)
+            std::rethrow_exception(error);
+        return *value();
+    }
+
+    bool satisfied() const noexcept { return status.load(std::memory_order_relaxed) != pending; }
+
+private:
+    enum : int { pending, setting, hasValue, hasError };
+
+    // The free list of this thread for this T. States left on it when the
+    // thread exits are deleted.
+    struct FreeList {
+        FutureState* head { nullptr };
+        std::size_t size { 0 };
+        ~FreeList()
+        {
+            while (head) {
+                auto next = head->nextFree;
+                delete head;
+                head = next;
+            }
+        }
+    };
+
+    static FreeList& freeList() noexcept
+    {
+        static thread_local FreeList fl;
+        return fl;
+    }
+
+    FutureState() = default;
+
+    void claim()
+    {
+        auto expected = static_cast<int>(pending);
+        if (!status.compare_exchange_strong(expected, setting, std::memory_order_relaxed))
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+    }
+
+    void publish(int result, std::exception_ptr e)
+    {
+        error = std::move(e);
+        status.store(result, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+        { std::lock_guard<std::mutex> g(m); }
+        cv.notify_all();
+    }
+
+    T* value() noexcept { return reinterpret_cast<T*>(&storage); }
+
+    std::atomic<int> status { pending };
+    std::atomic<unsigned> refs { 1 };
+    std::atomic<int> waiters { 0 };
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+    std::exception_ptr error;
+    std::mutex m;
+    std::condition_variable cv;
+    FutureState* nextFree { nullptr };
+};
+
+
+template<typename T>
+class PooledSharedFuture;
+
+template<typename T>
+class PooledFuture {
+public:
+    PooledFuture() noexcept = default;
+    PooledFuture(PooledFuture&& rhs) noexcept : state(std::exchange(rhs.state, nullptr)) {}
+    PooledFuture& operator=(PooledFuture&& rhs) noexcept
+    {
+        std::swap(state, rhs.state);
+        return *this;
+    }
+    // Never blocks.
+    ~PooledFuture()
+    {
+        if (state)
+            state->release();
+    }
+
+    bool valid() const noexcept { return state != nullptr; }
+    bool ready() const noexcept { return state->ready(); }
+    void wait() const { state->wait(); }
+
+    // Waits, then moves the value out (or rethrows). Like std::future::get,
+    // it can only be called once; afterwards the future isn't valid().
+    T get()
+    {
+        state->wait();
+        auto s = std::exchange(state, nullptr);
+        struct Release {
+            FutureState<T>* s;
+            ~Release() { s->release(); }
+        } release { s };
+        return std::move(s->get());
+    }
+
+    PooledSharedFuture<T> share() noexcept
+    {
+        return PooledSharedFuture<T>(std::exchange(state, nullptr));
+    }
+
+private:
+    template<typename> friend class PooledPromise;
+    explicit PooledFuture(FutureState<T>* s) noexcept : state(s) {}
+
+    FutureState<T>* state { nullptr };
+};
+
+template<typename T>
+class PooledSharedFuture {
+public:
+    PooledSharedFuture() noexcept = default;
+    PooledSharedFuture(const PooledSharedFuture& rhs) noexcept : state(rhs.state)
+    {
+        if (state)
+            state->addRef();
+    }
+    PooledSharedFuture(PooledSharedFuture&& rhs) noexcept
+        : state(std::exchange(rhs.state, nullptr))
+    {}
+    PooledSharedFuture& operator=(PooledSharedFuture rhs) noexcept
+    {
+        std::swap(state, rhs.state);
+        return *this;
+    }
+    // Never blocks.
+    ~PooledSharedFuture()
+    {
+        if (state)
+            state->release();
+    }
+
+    bool valid() const noexcept { return state != nullptr; }
+    bool ready() const noexcept { return state->ready(); }
+    void wait() const { state->wait(); }
+
+    // Waits if needed; once the value is there, no locks, no writes.
+    const T& get() const
+    {
+        if (!state->ready())
+            state->wait();
+        return state->get();
+    }
+
+private:
+    friend class PooledFuture<T>;
+    explicit PooledSharedFuture(FutureState<T>* s) noexcept : state(s) {}
+
+    FutureState<T>* state { nullptr };
+};
+
+template<typename T>
+class PooledPromise {
+public:
+    PooledPromise() : state(FutureState<T>::make()) {}
+    PooledPromise(PooledPromise&& rhs) noexcept
+        : state(std::exchange(rhs.state, nullptr)), retrieved(rhs.retrieved)
+    {}
+    PooledPromise& operator=(PooledPromise&& rhs) noexcept
+    {
+        std::swap(state, rhs.state);
+        std::swap(retrieved, rhs.retrieved);
+        return *this;
+    }
+    // Never blocks. Breaks the promise if nothing was set.
+    ~PooledPromise()
+    {
+        if (!state)
+            return;
+        if (!state->satisfied())
+            state->setException(std::make_exception_ptr(
+                std::future_error(std::future_errc::broken_promise)));
+        state->release();
+    }
+
+    PooledFuture<T> get_future()
+    {
+        if (retrieved)
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        retrieved = true;
+        state->addRef();
+        return PooledFuture<T>(state);
+    }
+
+    template<typename U>
+    void set_value(U&& v) { state->setValue(std::forward<U>(v)); }
+    void set_exception(std::exception_ptr e) { state->setException(std::move(e)); }
+
+private:
+    FutureState<T>* state;
+    bool retrieved { false };
+};
+
+#endif // __POOLED_FUTURE__H__
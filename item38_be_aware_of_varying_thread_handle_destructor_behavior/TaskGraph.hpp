@@ -0,0 +1,287 @@
+#ifndef __TASK_GRAPH__H__
+#define __TASK_GRAPH__H__
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../common/Trace.hpp"
+
+
+// A graph of std::packaged_tasks with dependencies, run on a pool of threads.
+//
+//   TaskGraph g;
+//   auto a = g.add("load", [] { return load(); });
+//   auto b = g.add("parse", [fa = a.result.share()] { return parse(fa.get()); });
+//   g.precede(a, b);           // b runs after a
+//   g.run(4);                  // blocks until every task has run
+//   b.result.get();
+//
+// Each task is still a packaged_task, so its result or exception ends up in
+// its future. A task that depends on another usually captures that task's
+// (shared) future and calls get(), which never blocks: the dependency has
+// finished by then. A task that throws doesn't stop the graph; whoever calls
+// get() on its future gets the exception, as with a single packaged_task.
+//
+// Tasks start as soon as all their predecessors are done. When several are
+// ready, Schedule::criticalPath (the default) starts the one with the longest
+// chain of work still behind it, counting each task's cost estimate, so
+// long chains start early and don't end up running alone at the end;
+// Schedule::fifo starts them in the order they became ready.
+//
+// After run(), report() prints when and where each task ran.
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+    using Clock = std::chrono::steady_clock;
+
+    enum class Schedule { criticalPath, fifo };
+
+    template<typename R>
+    struct Handle {
+        NodeId id;
+        std::future<R> result;
+        operator NodeId() const noexcept { return id; }
+    };
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // cost is an estimate of the task's run time in any unit, as long as
+    // it's the same unit for every task; it's only used for prioritizing.
+    template<typename F>
+    auto add(std::string name, F&& f, double cost = 1.0)
+    {
+        using R = std::result_of_t<std::decay_t<F>()>;
+        std::packaged_task<R()> task(std::forward<F>(f));
+        Handle<R> handle { nodes.size(), task.get_future() };
+        Node node;
+        node.name = std::move(name);
+        node.cost = cost;
+        // packaged_task<void()> can hold a move-only callable, so the typed
+        // task moves in whole; its exceptions stay in its own future.
+        node.run = std::packaged_task<void()>(
+            [t = std::move(task)]() mutable { t(); });
+        nodes.push_back(std::move(node));
+        return handle;
+    }
+
+    // after runs only once before has finished.
+    void precede(NodeId before, NodeId after)
+    {
+        if (before >= nodes.size() || after >= nodes.size())
+            throw std::out_of_range("TaskGraph::precede: no such task");
+        nodes[before].successors.push_back(after);
+        ++nodes[after].predecessors;
+    }
+
+    std::size_t size() const noexcept { return nodes.size(); }
+
+    // Runs every task once, on threads threads (at least one), and returns
+    // when all are done. Throws std::logic_error, before running anything,
+    // if the dependencies have a cycle or the graph has already run: a
+    // packaged_task can only run once.
+    void run(unsigned threads = std::thread::hardware_concurrency(),
+             Schedule schedule = Schedule::criticalPath)
+    {
+        if (ran)
+            throw std::logic_error("TaskGraph::run: the graph has already run");
+        TRACE_SPAN("TaskGraph::run");
+        auto order = topologicalOrder();
+        computeRanks(order);
+
+        Scheduler s(*this, schedule);
+        for (NodeId i = 0; i < nodes.size(); ++i) {
+            nodes[i].waitingFor = nodes[i].predecessors;
+            if (nodes[i].waitingFor == 0)
+                s.push(i);
+        }
+        ran = true;
+        s.start = Clock::now();
+        std::vector<std::thread> pool;
+        threads = std::max(threads, 1u);
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back([&s, t] { s.work(t); });
+        for (auto& t : pool)
+            t.join();
+        wall = Clock::now() - s.start;
+    }
+
+    // One line per task in start order: thread, start and duration in us,
+    // and its rank (cost of the longest chain from it to the end of the
+    // graph). Then the totals.
+    void report(std::ostream& os) const
+    {
+        std::vector<NodeId> byStart(nodes.size());
+        for (NodeId i = 0; i < nodes.size(); ++i)
+            byStart[i] = i;
+        std::sort(byStart.begin(), byStart.end(),
+                  [this](NodeId a, NodeId b) { return nodes[a].started < nodes[b].started; });
+        std::ios_base::fmtflags flags(os.flags());
+        auto precision = os.precision();
+        os << std::fixed << std::setprecision(1);
+        double busy = 0;
+        for (auto i : byStart) {
+            const auto& n = nodes[i];
+            auto start = us(n.started);
+            auto length = us(n.finished - n.started);
+            busy += length;
+            os << std::setw(16) << n.name << "  thread " << n.thread << "  start "
+               << std::setw(10) << start << " us  took " << std::setw(10) << length
+               << " us  rank " << n.rank << '\n';
+        }
+        auto total = us(wall);
+        os << nodes.size() << " tasks, wall " << total << " us, busy " << busy
+           << " us, parallelism " << (total > 0 ? busy / total : 0.0) << '\n';
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    Clock::duration wallTime() const noexcept { return wall; }
+
+private:
+    struct Node {
+        std::string name;
+        double cost { 1.0 };
+        std::packaged_task<void()> run;
+        std::vector<NodeId> successors;
+        std::size_t predecessors { 0 };
+
+        // per run
+        std::size_t waitingFor { 0 };
+        double rank { 0 };
+        unsigned thread { 0 };
+        Clock::duration started {};
+        Clock::duration finished {};
+    };
+
+    // The ready queue and the dependency counts it guards.
+    struct Scheduler {
+        Scheduler(TaskGraph& graph, Schedule s)
+            : g(graph), schedule(s)
+        {}
+
+        // Called with the lock held, or before the workers start.
+        void push(NodeId i)
+        {
+            if (schedule == Schedule::fifo)
+                fifo.push(i);
+            else
+                byRank.push({ g.nodes[i].rank, i });
+        }
+        bool empty() const noexcept { return fifo.empty() && byRank.empty(); }
+        NodeId pop()
+        {
+            NodeId i;
+            if (schedule == Schedule::fifo) {
+                i = fifo.front();
+                fifo.pop();
+            } else {
+                i = byRank.top().second;
+                byRank.pop();
+            }
+            return i;
+        }
+
+        void work(unsigned thread)
+        {
+            TRACE_THREAD_NAME("TaskGraph worker " + std::to_string(thread));
+            std::unique_lock<std::mutex> lock(m);
+            for (;;) {
+                cv.wait(lock, [this] { return !empty() || done == g.nodes.size(); });
+                if (empty())
+                    return;
+                auto i = pop();
+                lock.unlock();
+
+                auto& node = g.nodes[i];
+                node.thread = thread;
+                node.started = Clock::now() - start;
+                {
+                    TRACE_SPAN(node.name);
+                    node.run();
+                }
+                node.finished = Clock::now() - start;
+
+                lock.lock();
+                ++done;
+                std::size_t woken = 0;
+                for (auto next : node.successors)
+                    if (--g.nodes[next].waitingFor == 0) {
+                        push(next);
+                        ++woken;
+                    }
+                if (done == g.nodes.size())
+                    cv.notify_all();
+                else if (woken > 1)
+                    cv.notify_all();
+                else if (woken == 1)
+                    cv.notify_one();
+            }
+        }
+
+        TaskGraph& g;
+        Schedule schedule;
+        Clock::time_point start;
+        std::mutex m;
+        std::condition_variable cv;
+        std::queue<NodeId> fifo;
+        std::priority_queue<std::pair<double, NodeId>> byRank;
+        std::size_t done { 0 };
+    };
+
+    // Kahn's algorithm; throws if some tasks are never freed (a cycle).
+    std::vector<NodeId> topologicalOrder() const
+    {
+        std::vector<std::size_t> waiting(nodes.size());
+        std::vector<NodeId> order;
+        order.reserve(nodes.size());
+        for (NodeId i = 0; i < nodes.size(); ++i) {
+            waiting[i] = nodes[i].predecessors;
+            if (waiting[i] == 0)
+                order.push_back(i);
+        }
+        for (std::size_t k = 0; k < order.size(); ++k)
+            for (auto next : nodes[order[k]].successors)
+                if (--waiting[next] == 0)
+                    order.push_back(next);
+        if (order.size() != nodes.size())
+            throw std::logic_error("TaskGraph::run: the dependencies have a cycle");
+        return order;
+    }
+
+    // rank = own cost + the largest rank among successors
+    void computeRanks(const std::vector<NodeId>& order)
+    {
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            auto& n = nodes[*it];
+            double behind = 0;
+            for (auto next : n.successors)
+                behind = std::max(behind, nodes[next].rank);
+            n.rank = n.cost + behind;
+        }
+    }
+
+    static double us(Clock::duration d)
+    {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+
+    std::vector<Node> nodes;
+    bool ran { false };
+    Clock::duration wall {};
+};
+
+#endif // __TASK_GRAPH__H__
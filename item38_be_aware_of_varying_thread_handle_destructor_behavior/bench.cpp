@@ -0,0 +1,290 @@
+#include <chrono>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/AllocCounter.hpp"
+#include "../common/Bench.hpp"
+#include "../common/Trace.hpp"
+#include "PooledFuture.hpp"
+#include "TaskGraph.hpp"
+
+
+// Synthetic graphs of 1000 tasks that each spin for about 2us:
+//   wide:   one source, 998 independent tasks, one sink
+//   deep:   a chain of 1000
+//   mixed:  a chain of 200 next to 800 independent tasks, the case where
+//           starting the chain first (critical path) beats FIFO
+// run sequentially in dependency order, with a packaged_task on its own
+// std::thread per task (item38's pattern, started and joined wave by wave),
+// and on a TaskGraph with 1 and 4 threads, prioritized and FIFO. Graphs are
+// built untimed. ns/op is per task.
+//
+// Then std::promise/std::future against PooledPromise/PooledFuture:
+//   - create a pair, set the value, get it, all on one thread; with the
+//     heap allocations per pair as a counter
+//   - 1000 pairs made here, fulfilled by another thread, read back here
+//   - one shared future read by 8 threads, 100k get() calls each; ns/op is
+//     wall time per get()
+//
+// Last, what the tracing in TaskGraph, PooledFuture and friends costs per
+// event: TRACE_SPAN as built here (without TRACE_ENABLED, so nothing), a
+// TraceSpan with a literal name and with a std::string name (what TaskGraph
+// records per task), an instant event, and writing one event out as JSON.
+// Each batch records 100k events into a cleared buffer.
+
+constexpr std::size_t graphSize = 1000;
+constexpr auto taskTime = std::chrono::microseconds(2);
+
+void spin()
+{
+    auto end = std::chrono::steady_clock::now() + taskTime;
+    while (std::chrono::steady_clock::now() < end)
+        ;
+}
+
+// Edges of the synthetic graphs, as (before, after) pairs over node ids
+// 0..graphSize-1.
+using Edges = std::vector<std::pair<std::size_t, std::size_t>>;
+
+Edges wideEdges()
+{
+    Edges e;
+    for (std::size_t i = 1; i + 1 < graphSize; ++i) {
+        e.push_back({ 0, i });
+        e.push_back({ i, graphSize - 1 });
+    }
+    return e;
+}
+
+Edges deepEdges()
+{
+    Edges e;
+    for (std::size_t i = 1; i < graphSize; ++i)
+        e.push_back({ i - 1, i });
+    return e;
+}
+
+// The chain is made of the last 200 nodes, so FIFO, which starts ready
+// tasks in id order, reaches it last.
+Edges mixedEdges()
+{
+    Edges e;
+    for (std::size_t i = graphSize - 199; i < graphSize; ++i)
+        e.push_back({ i - 1, i });
+    return e;
+}
+
+std::unique_ptr<TaskGraph> build(const Edges& edges)
+{
+    auto g = std::make_unique<TaskGraph>();
+    for (std::size_t i = 0; i < graphSize; ++i)
+        g->add("t" + std::to_string(i), spin);
+    for (const auto& e : edges)
+        g->precede(e.first, e.second);
+    return g;
+}
+
+// A packaged_task and a std::thread per task. Tasks whose predecessors are
+// all done are started together, then joined, then the next wave.
+void threadPerTask(const Edges& edges)
+{
+    std::vector<std::vector<std::size_t>> successors(graphSize);
+    std::vector<std::size_t> waiting(graphSize);
+    for (const auto& e : edges) {
+        successors[e.first].push_back(e.second);
+        ++waiting[e.second];
+    }
+    std::vector<std::size_t> wave;
+    for (std::size_t i = 0; i < graphSize; ++i)
+        if (waiting[i] == 0)
+            wave.push_back(i);
+    while (!wave.empty()) {
+        std::vector<std::thread> threads;
+        for (std::size_t k = 0; k < wave.size(); ++k) {
+            std::packaged_task<void()> pt(spin);
+            threads.emplace_back(std::move(pt));
+        }
+        for (auto& t : threads)
+            t.join();
+        std::vector<std::size_t> next;
+        for (auto i : wave)
+            for (auto s : successors[i])
+                if (--waiting[s] == 0)
+                    next.push_back(s);
+        wave.swap(next);
+    }
+}
+
+constexpr std::size_t crossThreadPairs = 1000;
+constexpr int readers = 8;
+constexpr std::size_t readsPerReader = 100000;
+
+template<template<typename> class Promise>
+void createSetGet()
+{
+    Promise<double> p;
+    auto f = p.get_future();
+    p.set_value(1.0);
+    bench::doNotOptimize(f.get());
+}
+
+template<template<typename> class Promise>
+void crossThread()
+{
+    std::vector<Promise<double>> promises(crossThreadPairs);
+    std::vector<decltype(promises[0].get_future())> futures;
+    futures.reserve(crossThreadPairs);
+    for (auto& p : promises)
+        futures.push_back(p.get_future());
+    std::thread setter([&promises] {
+        for (auto& p : promises)
+            p.set_value(2.0);
+    });
+    double sum = 0;
+    for (auto& f : futures)
+        sum += f.get();
+    setter.join();
+    bench::doNotOptimize(sum);
+}
+
+template<typename SharedFuture, typename Promise>
+void fanOut()
+{
+    Promise p;
+    SharedFuture shared = p.get_future().share();
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r)
+        threads.emplace_back([shared] {
+            double sum = 0;
+            for (std::size_t i = 0; i < readsPerReader; ++i)
+                sum += shared.get();
+            bench::doNotOptimize(sum);
+        });
+    p.set_value(3.0);
+    for (auto& t : threads)
+        t.join();
+}
+
+template<typename F>
+double allocsPerCall(F f)
+{
+    constexpr int calls = 1000;
+    instrument::AllocScope scope;
+    for (int i = 0; i < calls; ++i)
+        f();
+    return static_cast<double>(scope.delta().allocations) / calls;
+}
+
+void futureRows(bench::Runner& runner)
+{
+    auto withAllocs = [&runner](bench::Result* r, double allocs) {
+        if (r)
+            runner.counter(r, "heap allocations per pair", allocs);
+    };
+    withAllocs(runner.run("future: std::promise, set, get", createSetGet<std::promise>),
+               allocsPerCall(createSetGet<std::promise>));
+    withAllocs(runner.run("future: PooledPromise, set, get", createSetGet<PooledPromise>),
+               allocsPerCall(createSetGet<PooledPromise>));
+
+    runner.runBatch("future: std::promise, set on another thread", crossThreadPairs,
+                    crossThread<std::promise>);
+    runner.runBatch("future: PooledPromise, set on another thread", crossThreadPairs,
+                    crossThread<PooledPromise>);
+
+    runner.runBatch("future: std::shared_future, 8 readers", readers * readsPerReader,
+                    fanOut<std::shared_future<double>, std::promise<double>>);
+    runner.runBatch("future: PooledSharedFuture, 8 readers", readers * readsPerReader,
+                    fanOut<PooledSharedFuture<double>, PooledPromise<double>>);
+}
+
+constexpr std::size_t traceEvents = 100000;
+
+void traceRows(bench::Runner& runner)
+{
+    auto clear = [] { instrument::clearThreadTrace(); };
+    runner.runBatch("trace: TRACE_SPAN, compiled out", traceEvents, clear, [] {
+        for (std::size_t i = 0; i < traceEvents; ++i) {
+            TRACE_SPAN("span");
+            bench::doNotOptimize(i);
+        }
+    });
+    runner.runBatch("trace: TraceSpan, literal name", traceEvents, clear, [] {
+        for (std::size_t i = 0; i < traceEvents; ++i) {
+            instrument::TraceSpan span("span");
+            bench::doNotOptimize(i);
+        }
+    });
+    std::string name = "task 42";
+    runner.runBatch("trace: TraceSpan, std::string name", traceEvents, clear, [&name] {
+        for (std::size_t i = 0; i < traceEvents; ++i) {
+            instrument::TraceSpan span(name);
+            bench::doNotOptimize(i);
+        }
+    });
+    runner.runBatch("trace: traceInstant", traceEvents, clear, [] {
+        for (std::size_t i = 0; i < traceEvents; ++i)
+            instrument::traceInstant("instant");
+    });
+    runner.runBatch("trace: writeTrace, per event", traceEvents,
+        [] {
+            instrument::clearThreadTrace();
+            for (std::size_t i = 0; i < traceEvents; ++i)
+                instrument::TraceSpan span("span");
+        },
+        [] {
+            std::ostringstream out;
+            instrument::writeTrace(out);
+            bench::doNotOptimize(out.str().size());
+        });
+    instrument::clearThreadTrace();
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item38", argc, argv);
+
+    struct Shape {
+        const char* name;
+        Edges edges;
+    };
+    const Shape shapes[] = {
+        { "wide", wideEdges() },
+        { "deep", deepEdges() },
+        { "mixed", mixedEdges() },
+    };
+
+    for (const auto& shape : shapes) {
+        const auto& edges = shape.edges;
+        std::string prefix = shape.name;
+        runner.runBatch(prefix + ": sequential", graphSize, [] {
+            for (std::size_t i = 0; i < graphSize; ++i)
+                spin();
+        });
+        runner.runBatch(prefix + ": thread per task", graphSize, [&] { threadPerTask(edges); });
+
+        struct Config {
+            const char* name;
+            unsigned threads;
+            TaskGraph::Schedule schedule;
+        };
+        const Config configs[] = {
+            { "TaskGraph 1 thread", 1, TaskGraph::Schedule::criticalPath },
+            { "TaskGraph 4 threads, critical path", 4, TaskGraph::Schedule::criticalPath },
+            { "TaskGraph 4 threads, fifo", 4, TaskGraph::Schedule::fifo },
+        };
+        for (const auto& c : configs) {
+            std::unique_ptr<TaskGraph> g;
+            runner.runBatch(prefix + ": " + c.name, graphSize,
+                            [&] { g = build(edges); },
+                            [&] { g->run(c.threads, c.schedule); });
+        }
+    }
+
+    futureRows(runner);
+    traceRows(runner);
+
+    return runner.finish();
+}
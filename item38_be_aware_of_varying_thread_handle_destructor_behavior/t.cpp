@@ -2,6 +2,9 @@
 #include <thread>
 #include <iostream>
 #include <vector>
+#include "../common/Trace.hpp"
+#include "PooledFuture.hpp"
+#include "TaskGraph.hpp"
 
 // destruction of a joinable std::thread terminates your program,
 // because the two obvious alternatives - an implicit join and
@@ -32,8 +35,19 @@ private:
     std::shared_future<double> fut;
 };
 
+// PooledWidget objects never block in their dtors: a PooledSharedFuture only
+// drops a reference to its shared state, and the last one out recycles it.
+class PooledWidget {
+public:
+    explicit PooledWidget(PooledSharedFuture<double> f) : fut(std::move(f)) {}
+    double value() const { return fut.get(); }
+private:
+    PooledSharedFuture<double> fut;
+};
+
 int calcVaule()
 {
+    TRACE_SPAN("calcVaule");
     return 10;
 }
 
@@ -41,6 +55,8 @@ int calcVaule()
 
 int main()
 {
+    TRACE_THREAD_NAME("main");
+
     // this container might block in its dtor, because one or more
     // contained futures could refer to a shared state for a non-deferred
     // task launch via std::async.
@@ -69,5 +85,60 @@ int main()
         std::cout << fut.get() << '\n';
     }
 
+    // the same packaged_task, but as one node of a graph: each task starts
+    // as soon as the ones it depends on are done, on a shared pool, and no
+    // task owns a thread to join.
+    {
+        TaskGraph g;
+        auto calc = g.add("calc", calcVaule);
+        auto fcalc = calc.result.share();
+        auto twice = g.add("twice", [fcalc] { return 2 * fcalc.get(); });
+        auto square = g.add("square", [fcalc] { return fcalc.get() * fcalc.get(); });
+        auto ftwice = twice.result.share();
+        auto fsquare = square.result.share();
+        auto sum = g.add("sum", [ftwice, fsquare] { return ftwice.get() + fsquare.get(); });
+        g.precede(calc, twice);
+        g.precede(calc, square);
+        g.precede(twice, sum);
+        g.precede(square, sum);
+        g.run(2);
+        std::cout << sum.result.get() << '\n';
+        g.report(std::cout);
+    }
+
+    // one result, many readers: each reader's PooledWidget holds a copy of
+    // the same shared future, and reads it without taking a lock.
+    {
+        PooledPromise<double> p;
+        auto shared = p.get_future().share();
+        std::vector<std::thread> readers;
+        std::vector<double> seen(4);
+        for (std::size_t i = 0; i < seen.size(); ++i)
+            readers.emplace_back([shared, &seen, i] {
+                PooledWidget w(shared);
+                seen[i] = w.value();
+            });
+        p.set_value(calcVaule() / 4.0);
+        for (auto& t : readers)
+            t.join();
+        for (auto v : seen)
+            std::cout << v << ' ';
+        std::cout << '\n';
+    }
+    {
+        PooledFuture<int> fut;
+        {
+            PooledPromise<int> p;
+            fut = p.get_future();
+        }
+        try {
+            fut.get();
+        } catch (const std::future_error& e) {
+            std::cout << e.what() << '\n';
+        }
+    }
 
+    // with 'make trace': the packaged_task threads, the graph's workers and
+    // the readers blocked on the pooled future as a timeline
+    TRACE_WRITE("trace.json");
 }
@@ -0,0 +1,66 @@
+#ifndef __ATOMICS__H__
+#define __ATOMICS__H__
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+
+// std::atomic operations default to memory_order_seq_cst, the strongest and
+// most expensive ordering. Most uses need much less. These wrappers pick the
+// weakest ordering that is still correct for one job, so call sites can't get
+// it wrong either way. t.cpp runs litmus tests for each of them.
+
+// A counter that's only ever read as a number: statistics, or ac in main. The
+// increments are atomic, so none are lost, but they don't order anything
+// else. Reading it after joining the threads that bumped it gives the exact
+// total; join already synchronizes.
+//
+// Don't use it to decide that some other data is ready; that's ReadyFlag.
+template<typename T = long>
+class RelaxedCounter {
+public:
+    constexpr RelaxedCounter(T initial = 0) noexcept : value(initial) {}
+    RelaxedCounter(const RelaxedCounter&) = delete;
+    RelaxedCounter& operator=(const RelaxedCounter&) = delete;
+
+    T operator++() noexcept { return add(1) + 1; }
+    T operator++(int) noexcept { return add(1); }
+    T add(T n) noexcept { return value.fetch_add(n, std::memory_order_relaxed); }
+
+    T get() const noexcept { return value.load(std::memory_order_relaxed); }
+    operator T() const noexcept { return get(); }
+
+private:
+    std::atomic<T> value;
+};
+
+// A one-way "the data is ready" signal, like valAvailable in
+// detecting_and_reacting: one side writes some data and then sets the flag;
+// the other side sees the flag and then reads the data. Release on set and
+// acquire on test is exactly what makes those writes visible (the
+// message-passing pattern). It doesn't give a single total order across
+// several flags; two threads each setting one flag and testing the other's
+// can both see false. That needs seq_cst.
+class ReadyFlag {
+public:
+    ReadyFlag() noexcept = default;
+    ReadyFlag(const ReadyFlag&) = delete;
+    ReadyFlag& operator=(const ReadyFlag&) = delete;
+
+    void set() noexcept { flag.store(true, std::memory_order_release); }
+    // For reuse, once both sides are done with the data; it publishes nothing.
+    void clear() noexcept { flag.store(false, std::memory_order_relaxed); }
+    bool isSet() const noexcept { return flag.load(std::memory_order_acquire); }
+
+    void wait() const noexcept
+    {
+        while (!isSet())
+            std::this_thread::yield();
+    }
+
+private:
+    std::atomic<bool> flag { false };
+};
+
+#endif // __ATOMICS__H__
@@ -0,0 +1,424 @@
+#ifndef __RING_BUFFER__H__
+#define __RING_BUFFER__H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+// Bounded lock-free ring buffers for streaming values from detecting threads
+// to reacting threads, where detecting_and_reacting hands over one value
+// through a mutex, a condition variable and a flag.
+//
+//   SpscRing<T, Capacity>  one producer, one consumer. try_push/try_pop are
+//                          wait-free: a load, a copy and a release store.
+//   MpmcRing<T, Capacity>  any number of producers and consumers, after
+//                          Dmitry Vyukov's bounded MPMC queue: every cell has
+//                          a sequence number saying whose turn it is, so
+//                          producers and consumers only contend on the index
+//                          they advance.
+//
+// Both have
+//   - try_push / try_pop, which fail instead of waiting,
+//   - try_push_n / try_pop_n, which move up to n values with one index
+//     update, so a batch costs about as much synchronization as one value,
+//   - push / pop / push_n / pop_n, which wait until there's room or data.
+//
+// How they wait is the WaitMode parameter. WaitMode::spin spins, then
+// yields; nothing is added to the non-waiting path. WaitMode::block spins
+// briefly and then sleeps on a condition variable; the price is that every
+// push and pop checks, after a fence, whether anyone on the other side is
+// asleep, and the batch operations check once per batch.
+//
+// Capacity must be a power of two. T must be default constructible and
+// move assignable: the cells are Ts, and values are assigned into them. The
+// indices sit on separate cache lines, so the objects are over-aligned; keep
+// them on the stack or in static storage unless compiling for C++17.
+enum class WaitMode { spin, block };
+
+template<WaitMode Mode>
+class RingWait;
+
+template<>
+class RingWait<WaitMode::spin> {
+public:
+    template<typename Pred>
+    void wait(Pred ready) noexcept
+    {
+        for (unsigned spins = 0; !ready(); ++spins) {
+            if (spins < 64)
+                pause();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void notify() noexcept {}
+
+    static void pause() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+};
+
+template<>
+class RingWait<WaitMode::block> {
+public:
+    template<typename Pred>
+    void wait(Pred ready)
+    {
+        for (int i = 0; i < 64; ++i) {
+            if (ready())
+                return;
+            RingWait<WaitMode::spin>::pause();
+        }
+        std::unique_lock<std::mutex> lock(m);
+        // Announce ourselves before the last look at ready(). Paired with the
+        // fence in notify(): either we see the other side's update, or it
+        // sees us waiting.
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv.wait(lock, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+        // Taking the lock means the waiter is either not yet checking ready()
+        // or already inside cv.wait, so the notification can't fall between.
+        { std::lock_guard<std::mutex> g(m); }
+        cv.notify_all();
+    }
+
+private:
+    alignas(64) std::atomic<int> waiters { 0 };
+    std::mutex m;
+    std::condition_variable cv;
+};
+
+
+template<typename T, std::size_t Capacity, WaitMode Mode = WaitMode::block>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+    // Producer side.
+
+    template<typename U>
+    bool try_push(U&& v)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == Capacity)
+                return false;
+        }
+        cells[t & mask] = std::forward<U>(v);
+        tail.store(t + 1, std::memory_order_release);
+        notEmpty.notify();
+        return true;
+    }
+
+    // Pushes up to n values from first; returns how many.
+    template<typename It>
+    std::size_t try_push_n(It first, std::size_t n)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (Capacity - (t - cachedHead) < n)
+            cachedHead = head.load(std::memory_order_acquire);
+        n = std::min(n, Capacity - (t - cachedHead));
+        if (n == 0)
+            return 0;
+        for (std::size_t i = 0; i < n; ++i, ++first)
+            cells[(t + i) & mask] = *first;
+        tail.store(t + n, std::memory_order_release);
+        notEmpty.notify();
+        return n;
+    }
+
+    template<typename U>
+    void push(U&& v)
+    {
+        // a failed try_push leaves v alone, so forwarding it again is fine
+        while (!try_push(std::forward<U>(v)))
+            notFull.wait([this] {
+                return tail.load(std::memory_order_relaxed) -
+                       head.load(std::memory_order_acquire) < Capacity;
+            });
+    }
+
+    template<typename It>
+    void push_n(It first, std::size_t n)
+    {
+        while (n) {
+            auto pushed = try_push_n(first, n);
+            std::advance(first, pushed);
+            n -= pushed;
+            if (n)
+                notFull.wait([this] {
+                    return tail.load(std::memory_order_relaxed) -
+                           head.load(std::memory_order_acquire) < Capacity;
+                });
+        }
+    }
+
+    // Consumer side.
+
+    bool try_pop(T& out)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return false;
+        }
+        out = std::move(cells[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        notFull.notify();
+        return true;
+    }
+
+    // Pops up to max values into out; returns how many.
+    template<typename OutIt>
+    std::size_t try_pop_n(OutIt out, std::size_t max)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (cachedTail - h < max)
+            cachedTail = tail.load(std::memory_order_acquire);
+        auto n = std::min(max, cachedTail - h);
+        if (n == 0)
+            return 0;
+        for (std::size_t i = 0; i < n; ++i, ++out)
+            *out = std::move(cells[(h + i) & mask]);
+        head.store(h + n, std::memory_order_release);
+        notFull.notify();
+        return n;
+    }
+
+    T pop()
+    {
+        T v;
+        while (!try_pop(v))
+            notEmpty.wait([this] {
+                return tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed);
+            });
+        return v;
+    }
+
+    // Waits for at least one value, then pops up to max.
+    template<typename OutIt>
+    std::size_t pop_n(OutIt out, std::size_t max)
+    {
+        for (;;) {
+            if (auto n = try_pop_n(out, max))
+                return n;
+            notEmpty.wait([this] {
+                return tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed);
+            });
+        }
+    }
+
+private:
+    static constexpr std::size_t mask = Capacity - 1;
+
+    // Each side's index and its cached copy of the other side's index share
+    // a line, so in the common case each side only reads its own line.
+    alignas(64) std::atomic<std::size_t> tail { 0 };
+    std::size_t cachedHead { 0 };   // producer's
+    alignas(64) std::atomic<std::size_t> head { 0 };
+    std::size_t cachedTail { 0 };   // consumer's
+    alignas(64) T cells[Capacity] {};
+    RingWait<Mode> notEmpty;
+    RingWait<Mode> notFull;
+};
+
+
+template<typename T, std::size_t Capacity, WaitMode Mode = WaitMode::block>
+class MpmcRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+public:
+    MpmcRing()
+    {
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+    template<typename U>
+    bool try_push(U&& v)
+    {
+        std::size_t pos;
+        if (claim(tail, 0, 1, pos) == 0)
+            return false;
+        auto& c = cells[pos & mask];
+        c.value = std::forward<U>(v);
+        c.seq.store(pos + 1, std::memory_order_release);
+        notEmpty.notify();
+        return true;
+    }
+
+    // Claims up to n consecutive free cells with one update of the tail
+    // index, then fills them. Returns how many values were pushed.
+    template<typename It>
+    std::size_t try_push_n(It first, std::size_t n)
+    {
+        std::size_t pos;
+        n = claim(tail, 0, n, pos);
+        for (std::size_t i = 0; i < n; ++i, ++first) {
+            auto& c = cells[(pos + i) & mask];
+            c.value = *first;
+            c.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        if (n)
+            notEmpty.notify();
+        return n;
+    }
+
+    template<typename U>
+    void push(U&& v)
+    {
+        while (!try_push(std::forward<U>(v)))
+            notFull.wait([this] { return ready(tail, 0); });
+    }
+
+    template<typename It>
+    void push_n(It first, std::size_t n)
+    {
+        while (n) {
+            auto pushed = try_push_n(first, n);
+            std::advance(first, pushed);
+            n -= pushed;
+            if (n)
+                notFull.wait([this] { return ready(tail, 0); });
+        }
+    }
+
+    bool try_pop(T& out)
+    {
+        std::size_t pos;
+        if (claim(head, 1, 1, pos) == 0)
+            return false;
+        auto& c = cells[pos & mask];
+        out = std::move(c.value);
+        c.seq.store(pos + Capacity, std::memory_order_release);
+        notFull.notify();
+        return true;
+    }
+
+    template<typename OutIt>
+    std::size_t try_pop_n(OutIt out, std::size_t max)
+    {
+        std::size_t pos;
+        auto n = claim(head, 1, max, pos);
+        for (std::size_t i = 0; i < n; ++i, ++out) {
+            auto& c = cells[(pos + i) & mask];
+            *out = std::move(c.value);
+            c.seq.store(pos + i + Capacity, std::memory_order_release);
+        }
+        if (n)
+            notFull.notify();
+        return n;
+    }
+
+    T pop()
+    {
+        T v;
+        while (!try_pop(v))
+            notEmpty.wait([this] { return ready(head, 1); });
+        return v;
+    }
+
+    template<typename OutIt>
+    std::size_t pop_n(OutIt out, std::size_t max)
+    {
+        for (;;) {
+            if (auto n = try_pop_n(out, max))
+                return n;
+            notEmpty.wait([this] { return ready(head, 1); });
+        }
+    }
+
+private:
+    static constexpr std::size_t mask = Capacity - 1;
+
+    // A cell at position pos is free for a producer when its seq is pos, and
+    // holds a value for a consumer when its seq is pos + 1. lag is 0 for
+    // producers and 1 for consumers.
+    bool ready(const std::atomic<std::size_t>& index, std::size_t lag) const noexcept
+    {
+        auto pos = index.load(std::memory_order_relaxed);
+        return cells[pos & mask].seq.load(std::memory_order_acquire) == pos + lag;
+    }
+
+    // Advances index over up to n consecutive cells that are ready for this
+    // side, and returns how many it took, starting at pos. Cells that are
+    // ready can't stop being ready until the index moves past them, so
+    // checking first and then moving the index with one CAS is safe.
+    std::size_t claim(std::atomic<std::size_t>& index, std::size_t lag, std::size_t n,
+                      std::size_t& pos) noexcept
+    {
+        n = std::min(n, Capacity);
+        pos = index.load(std::memory_order_relaxed);
+        if (n == 0)
+            return 0;
+        for (;;) {
+            std::size_t k = 0;
+            std::intptr_t diff = 0;
+            for (; k < n; ++k) {
+                auto seq = cells[(pos + k) & mask].seq.load(std::memory_order_acquire);
+                diff = static_cast<std::intptr_t>(seq - (pos + k + lag));
+                if (diff != 0)
+                    break;
+            }
+            if (k > 0) {
+                // on failure pos is reloaded and we look again
+                if (index.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+                    return k;
+            } else if (diff < 0) {
+                return 0;   // full, or empty
+            } else {
+                pos = index.load(std::memory_order_relaxed);   // someone got there first
+            }
+        }
+    }
+
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T value {};
+    };
+
+    alignas(64) std::atomic<std::size_t> tail { 0 };
+    alignas(64) std::atomic<std::size_t> head { 0 };
+    alignas(64) Cell cells[Capacity];
+    RingWait<Mode> notEmpty;
+    RingWait<Mode> notFull;
+};
+
+#endif // __RING_BUFFER__H__
@@ -0,0 +1,266 @@
+#ifndef __SHM_CHANNEL__H__
+#define __SHM_CHANNEL__H__
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// A single-producer, single-consumer channel between two processes, over a
+// POSIX shared memory object that both map.
+//
+// This is the "special memory" the Item talks about: another process writes
+// it behind our back. volatile would stop the compiler from caching or
+// dropping our accesses, but it neither makes them atomic nor orders them
+// with respect to the message contents. What's needed is std::atomic, and
+// that works across processes as long as the atomics are lock-free (and so
+// address-free): the same instructions work whatever address each process
+// mapped the region at. Hence the static_asserts below.
+//
+// The ring is SpscRing's algorithm with the indices in the mapped header.
+// A side that has to wait spins briefly, then sleeps on a futex word in the
+// header; shared (not FUTEX_PRIVATE) futexes are keyed on the physical page,
+// so the other process can wake it. Senders and receivers only make the
+// wake syscall when the other side has said it's asleep.
+//
+// Linux only. Errors from the system calls are thrown as std::system_error.
+//
+//   auto ch = ShmChannel<Msg, 1024>::create("/name");   // one process
+//   auto ch = ShmChannel<Msg, 1024>::open("/name");     // the other
+//   ch.send(msg);  ...  auto msg = ch.receive();
+//   ShmChannel<Msg, 1024>::unlink("/name");             // when done
+template<typename T, std::size_t Capacity>
+class ShmChannel {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "messages are copied as bytes into shared memory");
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                  "atomics in shared memory must be lock-free");
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                  "futex needs a plain 32-bit word");
+public:
+    // Creates (or replaces) the shared memory object and initializes it.
+    static ShmChannel create(const std::string& name)
+    {
+        auto fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+        if (fd < 0)
+            throwErrno("shm_open " + name);
+        if (::ftruncate(fd, sizeof(Shared)) < 0) {
+            auto e = errno;
+            ::close(fd);
+            throwErrno("ftruncate " + name, e);
+        }
+        ShmChannel ch(fd);
+        ::new (ch.shared) Shared();
+        ch.shared->messageSize = sizeof(T);
+        ch.shared->messageAlign = alignof(T);
+        ch.shared->capacity = Capacity;
+        ch.shared->magic.store(magicValue, std::memory_order_release);
+        return ch;
+    }
+
+    // Maps a channel some other process created, with the same T (as far
+    // as its size and alignment tell) and Capacity, and picks up its indices
+    // wherever traffic left them.
+    static ShmChannel open(const std::string& name)
+    {
+        auto fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            throwErrno("shm_open " + name);
+        // mapping past the end of a shorter object would SIGBUS on access
+        struct stat st;
+        if (::fstat(fd, &st) < 0) {
+            auto e = errno;
+            ::close(fd);
+            throwErrno("fstat " + name, e);
+        }
+        if (static_cast<std::size_t>(st.st_size) != sizeof(Shared)) {
+            ::close(fd);
+            throw notThisType(name);
+        }
+        ShmChannel ch(fd);
+        const auto& sh = *ch.shared;
+        if (sh.magic.load(std::memory_order_acquire) != magicValue ||
+            sh.messageSize != sizeof(T) || sh.messageAlign != alignof(T) ||
+            sh.capacity != Capacity)
+            throw notThisType(name);
+        ch.cachedHead = sh.head.load(std::memory_order_acquire);
+        ch.cachedTail = sh.tail.load(std::memory_order_acquire);
+        return ch;
+    }
+
+    static void unlink(const std::string& name) noexcept
+    {
+        ::shm_unlink(name.c_str());
+    }
+
+    ShmChannel(ShmChannel&& rhs) noexcept
+        : shared(std::exchange(rhs.shared, nullptr)),
+          cachedHead(rhs.cachedHead), cachedTail(rhs.cachedTail)
+    {}
+    ShmChannel& operator=(ShmChannel&& rhs) noexcept
+    {
+        std::swap(shared, rhs.shared);
+        std::swap(cachedHead, rhs.cachedHead);
+        std::swap(cachedTail, rhs.cachedTail);
+        return *this;
+    }
+    ~ShmChannel()
+    {
+        if (shared)
+            ::munmap(shared, sizeof(Shared));
+    }
+
+    // Sender side.
+
+    bool try_send(const T& msg) noexcept
+    {
+        auto t = shared->tail.load(std::memory_order_relaxed);
+        // >= and not ==: a stale cache only makes the ring look fuller
+        if (t - cachedHead >= Capacity) {
+            cachedHead = shared->head.load(std::memory_order_acquire);
+            if (t - cachedHead >= Capacity)
+                return false;
+        }
+        shared->cells[t & mask] = msg;
+        shared->tail.store(t + 1, std::memory_order_release);
+        shared->notEmpty.ring();
+        return true;
+    }
+
+    void send(const T& msg) noexcept
+    {
+        while (!try_send(msg))
+            shared->notFull.wait([this] {
+                return shared->tail.load(std::memory_order_relaxed) -
+                       shared->head.load(std::memory_order_acquire) < Capacity;
+            });
+    }
+
+    // Receiver side.
+
+    bool try_receive(T& msg) noexcept
+    {
+        auto h = shared->head.load(std::memory_order_relaxed);
+        // likewise, a stale cache only makes it look emptier
+        if (h >= cachedTail) {
+            cachedTail = shared->tail.load(std::memory_order_acquire);
+            if (h >= cachedTail)
+                return false;
+        }
+        msg = shared->cells[h & mask];
+        shared->head.store(h + 1, std::memory_order_release);
+        shared->notFull.ring();
+        return true;
+    }
+
+    T receive() noexcept
+    {
+        T msg;
+        while (!try_receive(msg))
+            shared->notEmpty.wait([this] {
+                return shared->tail.load(std::memory_order_acquire) !=
+                       shared->head.load(std::memory_order_relaxed);
+            });
+        return msg;
+    }
+
+private:
+    static constexpr std::size_t mask = Capacity - 1;
+    static constexpr std::uint64_t magicValue = 0x53484d4348414e31;   // "SHMCHAN1"
+
+    // A futex word plus a "someone is asleep" count, both in shared memory.
+    struct Doorbell {
+        std::atomic<std::uint32_t> seq { 0 };
+        std::atomic<std::uint32_t> sleepers { 0 };
+
+        template<typename Pred>
+        void wait(Pred ready) noexcept
+        {
+            for (int i = 0; i < 100; ++i) {
+                if (ready())
+                    return;
+                // the other process may need this CPU to make progress
+                ::sched_yield();
+            }
+            while (!ready()) {
+                sleepers.fetch_add(1);
+                // paired with the fence in ring(): either we see the update,
+                // or the ringer sees us asleep and bumps seq
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto s = seq.load(std::memory_order_relaxed);
+                if (!ready())
+                    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&seq), FUTEX_WAIT,
+                              s, nullptr, nullptr, 0);
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        void ring() noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_relaxed) == 0)
+                return;
+            seq.fetch_add(1, std::memory_order_relaxed);
+            ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&seq), FUTEX_WAKE,
+                      INT_MAX, nullptr, nullptr, 0);
+        }
+    };
+
+    // The mapped region.
+    struct Shared {
+        std::atomic<std::uint64_t> magic { 0 };   // set last, by create()
+        std::uint32_t messageSize { 0 };
+        std::uint32_t messageAlign { 0 };
+        std::uint64_t capacity { 0 };
+        alignas(64) std::atomic<std::uint64_t> tail { 0 };
+        alignas(64) std::atomic<std::uint64_t> head { 0 };
+        alignas(64) Doorbell notEmpty;
+        alignas(64) Doorbell notFull;
+        alignas(64) T cells[Capacity];
+    };
+
+    explicit ShmChannel(int fd)
+    {
+        auto p = ::mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        auto e = errno;
+        ::close(fd);
+        if (p == MAP_FAILED)
+            throwErrno("mmap", e);
+        shared = static_cast<Shared*>(p);
+    }
+
+    static std::system_error notThisType(const std::string& name)
+    {
+        return std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                 name + " is not an initialized channel of this type");
+    }
+
+    [[noreturn]] static void throwErrno(const std::string& what, int e = errno)
+    {
+        throw std::system_error(e, std::system_category(), what);
+    }
+
+    Shared* shared { nullptr };
+    // process-local copies of the other side's index; never ahead of it
+    std::uint64_t cachedHead { 0 };
+    std::uint64_t cachedTail { 0 };
+};
+
+#endif // __SHM_CHANNEL__H__
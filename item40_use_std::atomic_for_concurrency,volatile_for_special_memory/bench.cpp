@@ -0,0 +1,473 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/Bench.hpp"
+#include "RingBuffer.hpp"
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ShmChannel.hpp"
+#endif
+
+
+// 1. Streaming ints from detector threads to reactor threads. ns/op is wall
+//    time per value transferred, threads started and joined included.
+//    - mutex + cv, one slot: detecting_and_reacting's handoff, done per value
+//    - mutex + cv, std::queue: the usual unbounded locked queue
+//    - SpscRing / MpmcRing, one value at a time and in batches of 64, with
+//      both wait modes
+// 2. What memory orderings cost: fetch_add and store with relaxed,
+//    acq_rel/release and seq_cst, from 1, 2 and 4 threads, each thread on
+//    the same atomic, on its own atomic in the same cache line (false
+//    sharing), or on its own padded line. ns/op is wall time divided by one
+//    thread's operations, so perfect scaling keeps it flat.
+//    On x86 every fetch_add is a locked instruction whatever the ordering,
+//    and only seq_cst stores differ (xchg instead of mov); on ARM and POWER
+//    the orderings differ for both.
+// 3. (Linux) Two processes on one host, 64-byte messages: a ShmChannel
+//    against a pipe and a UNIX socketpair. Throughput is one-way streaming,
+//    reported as ns per message and messages per second; latency is a
+//    ping-pong, reported per round trip and as the one-way half of it.
+
+constexpr std::size_t values = 200000;
+constexpr std::size_t slotValues = 20000;   // the one-slot handoff is slow
+constexpr std::size_t batchSize = 64;
+
+using Ring = SpscRing<int, 1024, WaitMode::block>;
+using SpinRing = SpscRing<int, 1024, WaitMode::spin>;
+using MRing = MpmcRing<int, 1024, WaitMode::block>;
+
+long long expectedSum(std::size_t n)
+{
+    return static_cast<long long>(n) * (n - 1) / 2;
+}
+
+void check(long long sum, long long expected, const char* what)
+{
+    if (sum != expected) {
+        std::cerr << what << ": got " << sum << ", expected " << expected << '\n';
+        std::exit(1);
+    }
+}
+
+long long slotHandoff(std::size_t n)
+{
+    std::mutex m;
+    std::condition_variable cv;
+    bool available = false;
+    int value = 0;
+    long long sum = 0;
+    std::thread reactor([&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return available; });
+            sum += value;
+            available = false;
+            cv.notify_one();
+        }
+    });
+    for (std::size_t i = 0; i < n; ++i) {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return !available; });
+        value = static_cast<int>(i);
+        available = true;
+        cv.notify_one();
+    }
+    reactor.join();
+    return sum;
+}
+
+long long lockedQueue(std::size_t n)
+{
+    std::mutex m;
+    std::condition_variable cv;
+    std::queue<int> q;
+    long long sum = 0;
+    std::thread reactor([&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return !q.empty(); });
+            sum += q.front();
+            q.pop();
+        }
+    });
+    for (std::size_t i = 0; i < n; ++i) {
+        {
+            std::lock_guard<std::mutex> g(m);
+            q.push(static_cast<int>(i));
+        }
+        cv.notify_one();
+    }
+    reactor.join();
+    return sum;
+}
+
+template<typename R>
+long long oneByOne(R& ring, std::size_t n)
+{
+    long long sum = 0;
+    std::thread reactor([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            sum += ring.pop();
+    });
+    for (std::size_t i = 0; i < n; ++i)
+        ring.push(static_cast<int>(i));
+    reactor.join();
+    return sum;
+}
+
+template<typename R>
+long long batched(R& ring, std::size_t n)
+{
+    long long sum = 0;
+    std::thread reactor([&] {
+        int batch[batchSize];
+        for (std::size_t received = 0; received < n;) {
+            auto k = ring.pop_n(batch, batchSize);
+            for (std::size_t i = 0; i < k; ++i)
+                sum += batch[i];
+            received += k;
+        }
+    });
+    int batch[batchSize];
+    for (std::size_t i = 0; i < n; i += batchSize) {
+        auto k = std::min(batchSize, n - i);
+        for (std::size_t j = 0; j < k; ++j)
+            batch[j] = static_cast<int>(i + j);
+        ring.push_n(batch, k);
+    }
+    reactor.join();
+    return sum;
+}
+
+// producers threads each push their share of 0..n-1; consumers split the
+// values between them however the ring hands them out
+long long manyToMany(MRing& ring, std::size_t n, int producers, int consumers)
+{
+    std::atomic<long long> remaining { static_cast<long long>(n) };
+    std::atomic<long long> sum { 0 };
+    std::vector<std::thread> threads;
+    for (int c = 0; c < consumers; ++c)
+        threads.emplace_back([&] {
+            long long local = 0;
+            // claim a value before popping it, so no one waits for a value
+            // that will never come
+            while (remaining.fetch_sub(1, std::memory_order_relaxed) > 0)
+                local += ring.pop();
+            sum += local;
+        });
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+            for (std::size_t i = p; i < n; i += producers)
+                ring.push(static_cast<int>(i));
+        });
+    for (auto& t : threads)
+        t.join();
+    return sum;
+}
+
+constexpr std::size_t orderOps = 200000;
+constexpr int maxThreads = 4;
+
+template<std::memory_order Order>
+struct FetchAdd {
+    static void apply(std::atomic<long>& a, long) { a.fetch_add(1, Order); }
+};
+
+template<std::memory_order Order>
+struct Store {
+    static void apply(std::atomic<long>& a, long i) { a.store(i, Order); }
+};
+
+struct alignas(64) PaddedAtomic {
+    std::atomic<long> value { 0 };
+};
+
+std::atomic<long> sharedAtomic { 0 };
+alignas(64) std::atomic<long> adjacentAtomics[maxThreads] {};   // one line
+PaddedAtomic paddedAtomics[maxThreads];
+
+template<typename Op>
+void hammer(int threads, std::atomic<long>& (*target)(int))
+{
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t)
+        ts.emplace_back([t, target] {
+            auto& a = target(t);
+            for (std::size_t i = 0; i < orderOps; ++i)
+                Op::apply(a, static_cast<long>(i));
+        });
+    for (auto& t : ts)
+        t.join();
+}
+
+template<typename Op>
+void orderRows(bench::Runner& runner, const std::string& opName)
+{
+    struct Pattern {
+        const char* name;
+        std::atomic<long>& (*target)(int);
+    };
+    static const Pattern patterns[] = {
+        { "same atomic", [](int) -> std::atomic<long>& { return sharedAtomic; } },
+        { "false sharing", [](int t) -> std::atomic<long>& { return adjacentAtomics[t]; } },
+        { "padded", [](int t) -> std::atomic<long>& { return paddedAtomics[t].value; } },
+    };
+    for (const auto& p : patterns)
+        for (int n = 1; n <= maxThreads; n *= 2) {
+            if (n == 1 && &p != patterns)
+                continue;   // one thread: the patterns are all the same
+            auto name = opName + ", " + p.name + " (" + std::to_string(n) + " threads)";
+            runner.runBatch(name, orderOps, [&] { hammer<Op>(n, p.target); });
+        }
+}
+
+#if defined(__linux__)
+struct Message {
+    std::uint64_t seq;
+    char payload[56];
+};
+static_assert(sizeof(Message) == 64, "one cache line");
+
+constexpr std::size_t ipcMessages = 100000;
+constexpr std::size_t ipcRoundTrips = 20000;
+using Channel = ShmChannel<Message, 1024>;
+
+// Runs child in a forked process and parent here, then reaps the child.
+template<typename Child, typename Parent>
+void forked(Child child, Parent parent)
+{
+    auto pid = ::fork();
+    if (pid < 0) {
+        std::perror("fork");
+        std::exit(1);
+    }
+    if (pid == 0) {
+        child();
+        ::_exit(0);
+    }
+    parent();
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "child failed\n";
+        std::exit(1);
+    }
+}
+
+void writeAll(int fd, const Message& m)
+{
+    auto p = reinterpret_cast<const char*>(&m);
+    for (std::size_t done = 0; done < sizeof m;) {
+        auto n = ::write(fd, p + done, sizeof m - done);
+        if (n <= 0)
+            ::_exit(1);
+        done += n;
+    }
+}
+
+Message readAll(int fd)
+{
+    Message m;
+    auto p = reinterpret_cast<char*>(&m);
+    for (std::size_t done = 0; done < sizeof m;) {
+        auto n = ::read(fd, p + done, sizeof m - done);
+        if (n <= 0)
+            ::_exit(1);
+        done += n;
+    }
+    return m;
+}
+
+// The child writes to writeFd, the parent reads from readFd; both are
+// closed afterwards.
+long long streamOverFd(int readFd, int writeFd)
+{
+    long long sum = 0;
+    forked([&] {
+        ::close(readFd);
+        Message m {};
+        for (std::size_t i = 0; i < ipcMessages; ++i) {
+            m.seq = i;
+            writeAll(writeFd, m);
+        }
+    }, [&] {
+        ::close(writeFd);
+        for (std::size_t i = 0; i < ipcMessages; ++i)
+            sum += readAll(readFd).seq;
+    });
+    ::close(readFd);
+    return sum;
+}
+
+long long streamOverShm(const std::string& name)
+{
+    long long sum = 0;
+    auto rx = Channel::create(name);
+    forked([&] {
+        auto tx = Channel::open(name);
+        Message m {};
+        for (std::size_t i = 0; i < ipcMessages; ++i) {
+            m.seq = i;
+            tx.send(m);
+        }
+    }, [&] {
+        for (std::size_t i = 0; i < ipcMessages; ++i)
+            sum += rx.receive().seq;
+    });
+    Channel::unlink(name);
+    return sum;
+}
+
+// The child echoes every message back.
+void pingPongOverFd(int parentRead, int parentWrite, int childRead, int childWrite)
+{
+    forked([&] {
+        for (std::size_t i = 0; i < ipcRoundTrips; ++i)
+            writeAll(childWrite, readAll(childRead));
+    }, [&] {
+        Message m {};
+        for (std::size_t i = 0; i < ipcRoundTrips; ++i) {
+            m.seq = i;
+            writeAll(parentWrite, m);
+            if (readAll(parentRead).seq != i)
+                std::exit(1);
+        }
+    });
+}
+
+void pingPongOverShm(const std::string& name)
+{
+    auto toChild = Channel::create(name + "-a");
+    auto toParent = Channel::create(name + "-b");
+    forked([&] {
+        auto in = Channel::open(name + "-a");
+        auto out = Channel::open(name + "-b");
+        for (std::size_t i = 0; i < ipcRoundTrips; ++i)
+            out.send(in.receive());
+    }, [&] {
+        Message m {};
+        for (std::size_t i = 0; i < ipcRoundTrips; ++i) {
+            m.seq = i;
+            toChild.send(m);
+            if (toParent.receive().seq != i)
+                std::exit(1);
+        }
+    });
+    Channel::unlink(name + "-a");
+    Channel::unlink(name + "-b");
+}
+
+void ipcRows(bench::Runner& runner)
+{
+    auto name = "/item40-bench-" + std::to_string(::getpid());
+    auto expected = expectedSum(ipcMessages);
+    auto throughput = [&runner](bench::Result* r) {
+        if (r)
+            runner.counter(r, "messages per second", 1e9 / r->nsPerOp.median);
+    };
+    auto latency = [&runner](bench::Result* r) {
+        if (r)
+            runner.counter(r, "one-way ns", r->nsPerOp.median / 2);
+    };
+
+    throughput(runner.runBatch("IPC stream: pipe", ipcMessages, [&] {
+        int fds[2];
+        if (::pipe(fds) < 0)
+            std::exit(1);
+        check(streamOverFd(fds[0], fds[1]), expected, "pipe");
+    }));
+    throughput(runner.runBatch("IPC stream: socketpair", ipcMessages, [&] {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+            std::exit(1);
+        check(streamOverFd(fds[0], fds[1]), expected, "socketpair");
+    }));
+    throughput(runner.runBatch("IPC stream: ShmChannel", ipcMessages, [&] {
+        check(streamOverShm(name), expected, "ShmChannel");
+    }));
+
+    latency(runner.runBatch("IPC round trip: pipes", ipcRoundTrips, [&] {
+        int down[2], up[2];
+        if (::pipe(down) < 0 || ::pipe(up) < 0)
+            std::exit(1);
+        pingPongOverFd(up[0], down[1], down[0], up[1]);
+        for (int fd : { down[0], down[1], up[0], up[1] })
+            ::close(fd);
+    }));
+    latency(runner.runBatch("IPC round trip: socketpair", ipcRoundTrips, [&] {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+            std::exit(1);
+        pingPongOverFd(fds[0], fds[0], fds[1], fds[1]);
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }));
+    latency(runner.runBatch("IPC round trip: ShmChannel", ipcRoundTrips, [&] {
+        pingPongOverShm(name);
+    }));
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item40", argc, argv);
+
+    static Ring ring;
+    static SpinRing spinRing;
+    static MRing mring;
+    auto expected = expectedSum(values);
+
+    runner.runBatch("mutex + cv, one slot", slotValues, [&] {
+        check(slotHandoff(slotValues), expectedSum(slotValues), "one slot");
+    });
+    runner.runBatch("mutex + cv, std::queue", values, [&] {
+        check(lockedQueue(values), expected, "std::queue");
+    });
+    runner.runBatch("SpscRing block, one by one", values, [&] {
+        check(oneByOne(ring, values), expected, "SpscRing");
+    });
+    runner.runBatch("SpscRing spin, one by one", values, [&] {
+        check(oneByOne(spinRing, values), expected, "SpscRing spin");
+    });
+    runner.runBatch("SpscRing block, batches of 64", values, [&] {
+        check(batched(ring, values), expected, "SpscRing batched");
+    });
+    runner.runBatch("SpscRing spin, batches of 64", values, [&] {
+        check(batched(spinRing, values), expected, "SpscRing spin batched");
+    });
+    runner.runBatch("MpmcRing block, 1 -> 1", values, [&] {
+        check(oneByOne(mring, values), expected, "MpmcRing");
+    });
+    runner.runBatch("MpmcRing block, 1 -> 1, batches of 64", values, [&] {
+        check(batched(mring, values), expected, "MpmcRing batched");
+    });
+    for (int n : { 2, 4 }) {
+        auto name = "MpmcRing block, " + std::to_string(n) + " -> " + std::to_string(n);
+        runner.runBatch(name, values, [&] {
+            check(manyToMany(mring, values, n, n), expected, "MpmcRing many");
+        });
+    }
+
+    orderRows<FetchAdd<std::memory_order_relaxed>>(runner, "fetch_add relaxed");
+    orderRows<FetchAdd<std::memory_order_acq_rel>>(runner, "fetch_add acq_rel");
+    orderRows<FetchAdd<std::memory_order_seq_cst>>(runner, "fetch_add seq_cst");
+    orderRows<Store<std::memory_order_relaxed>>(runner, "store relaxed");
+    orderRows<Store<std::memory_order_release>>(runner, "store release");
+    orderRows<Store<std::memory_order_seq_cst>>(runner, "store seq_cst");
+
+#if defined(__linux__)
+    ipcRows(runner);
+#endif
+
+    return runner.finish();
+}
@@ -3,6 +3,16 @@
 #include <iostream>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include "Atomics.hpp"
+#include "RingBuffer.hpp"
+#if defined(__linux__)
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <sys/wait.h>
+#include "ShmChannel.hpp"
+#endif
 
 // volatile is the way we tell compilers that we're dealing with
 // special memory. Its meaning to compilers is "Don't perform any
@@ -46,10 +56,191 @@ void detecting_and_reacting()
         imptValue = computeImportantValue(10); 
         valAvailable = true;
     }
+    // without this, a reactor already waiting would never wake up
+    cv.notify_one();
     t.join();
     std::cout << imptValue << '\n';
 }
 
+// The same detect/react pair, but streaming many values. Handing each one
+// over through mu and cv would cost a lock and a wakeup per value; a ring
+// lets the detector run ahead by up to its capacity.
+void detecting_and_reacting_stream()
+{
+    constexpr int count = 100000;
+    SpscRing<int, 1024> ring;
+    long long sum = 0;
+    std::thread reactor([&ring, &sum]{
+        int batch[64];
+        for (int received = 0; received < count;) {
+            auto n = ring.pop_n(batch, 64);
+            for (std::size_t i = 0; i < n; ++i)
+                sum += batch[i];
+            received += static_cast<int>(n);
+        }
+    });
+    for (int i = 0; i < count; ++i)
+        ring.push(computeImportantValue(i));
+    reactor.join();
+    std::cout << sum << '\n';
+}
+#if defined(__linux__)
+// And with the detector in a different process: the values go through
+// memory both processes map, which is what volatile was made for, but it's
+// std::atomic that makes it work (see ShmChannel.hpp).
+void detecting_and_reacting_processes()
+{
+    constexpr int count = 1000;
+    using Channel = ShmChannel<int, 256>;
+    auto name = "/item40-demo-" + std::to_string(::getpid());
+    auto reactor = Channel::create(name);
+    auto pid = ::fork();
+    if (pid < 0) {
+        auto e = errno;
+        Channel::unlink(name);
+        throw std::system_error(e, std::system_category(), "fork");
+    }
+    if (pid == 0) {
+        // the child must never unwind into its copy of main
+        try {
+            auto detector = Channel::open(name);
+            for (int i = 0; i < count; ++i)
+                detector.send(computeImportantValue(i));
+        } catch (...) {
+            ::_exit(1);
+        }
+        ::_exit(0);
+    }
+    // receive() would wait forever for values from a child that died, so
+    // between values the reactor checks whether it's still there
+    long long sum = 0;
+    int received = 0, status = 0;
+    bool exited = false;
+    while (received < count) {
+        int value;
+        if (reactor.try_receive(value)) {
+            sum += value;
+            ++received;
+        } else if (exited) {
+            break;      // everything it sent has been read
+        } else if (::waitpid(pid, &status, WNOHANG) == pid) {
+            exited = true;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    if (!exited)
+        ::waitpid(pid, &status, 0);
+    Channel::unlink(name);
+    if (received < count || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "detector process failed after " << received << " values\n";
+        return;
+    }
+    std::cout << sum << '\n';
+}
+#endif
+
+// Litmus tests for the wrappers in Atomics.hpp: each runs a pattern many
+// times and counts outcomes the memory model forbids (or, for the last one,
+// allows only with weak orderings).
+
+// No increment is lost, even though none of them order anything.
+long litmus_counter()
+{
+    RelaxedCounter<long> c;
+    std::thread ts[4];
+    for (auto& t : ts)
+        t = std::thread([&c]{
+            for (int i = 0; i < 100000; ++i)
+                ++c;
+        });
+    for (auto& t : ts)
+        t.join();
+    return c.get();
+}
+
+// Message passing: a reader that sees the flag set must see the data written
+// before it. Like the store-buffering test below, the writer and the reader
+// are long-lived threads going through the rounds in lockstep with main, so
+// nothing but the flag orders the data: go only says a round started, and
+// the writer stores the data after it. data is atomic only so a failure is a
+// stale value rather than a data race; its accesses are relaxed. Returns how
+// many rounds saw stale data; must be 0. x86 would pass with a relaxed
+// ReadyFlag too (its stores aren't reordered); ARM and POWER wouldn't.
+int litmus_message_passing(int rounds)
+{
+    std::atomic<int> data(0);
+    ReadyFlag ready;
+    std::atomic<int> go(0), done(0);
+    int stale = 0;
+    auto waitFor = [&go](int i) {
+        while (go.load(std::memory_order_acquire) != i)
+            std::this_thread::yield();
+    };
+    std::thread writer([&, rounds]{
+        for (int i = 1; i <= rounds; ++i) {
+            waitFor(i);
+            data.store(i, std::memory_order_relaxed);
+            ready.set();
+            done.fetch_add(1, std::memory_order_acq_rel);
+        }
+    });
+    std::thread reader([&, rounds]{
+        for (int i = 1; i <= rounds; ++i) {
+            waitFor(i);
+            ready.wait();
+            if (data.load(std::memory_order_relaxed) != i)
+                ++stale;
+            done.fetch_add(1, std::memory_order_acq_rel);
+        }
+    });
+    for (int i = 1; i <= rounds; ++i) {
+        ready.clear();
+        go.store(i, std::memory_order_release);
+        while (done.load(std::memory_order_acquire) != 2 * i)
+            std::this_thread::yield();
+    }
+    writer.join();
+    reader.join();
+    return stale;
+}
+
+// Store buffering: each thread sets its own flag, then reads the other's.
+// Both reading 0 is allowed with release/acquire (x86 does it for real, its
+// stores wait in a store buffer) and forbidden with seq_cst. That's the case
+// ReadyFlag doesn't cover. Returns how many rounds both read 0.
+template<std::memory_order Store, std::memory_order Load>
+int litmus_store_buffering(int rounds)
+{
+    std::atomic<int> x(0), y(0);
+    std::atomic<int> go(0), done(0);
+    int r1 = 0, r2 = 0;
+    auto side = [&go, &done, rounds](std::atomic<int>& mine, std::atomic<int>& other, int& r){
+        for (int i = 1; i <= rounds; ++i) {
+            while (go.load(std::memory_order_acquire) != i)
+                std::this_thread::yield();
+            mine.store(1, Store);
+            r = other.load(Load);
+            done.fetch_add(1, std::memory_order_acq_rel);
+        }
+    };
+    std::thread t1(side, std::ref(x), std::ref(y), std::ref(r1));
+    std::thread t2(side, std::ref(y), std::ref(x), std::ref(r2));
+    int bothZero = 0;
+    for (int i = 1; i <= rounds; ++i) {
+        x.store(0, std::memory_order_relaxed);
+        y.store(0, std::memory_order_relaxed);
+        go.store(i, std::memory_order_release);
+        while (done.load(std::memory_order_acquire) != 2 * i)
+            std::this_thread::yield();
+        if (r1 == 0 && r2 == 0)
+            ++bothZero;
+    }
+    t1.join();
+    t2.join();
+    return bothZero;
+}
+
 
 int main()
 {
@@ -75,6 +266,29 @@ int main()
     // occur atomically.
     std::cout << vc << '\n';
 
+    // ac's increments only need to be indivisible; they order nothing else,
+    // so std::atomic's default, seq_cst, is more than they ask for.
+    // RelaxedCounter (Atomics.hpp) does the same count with relaxed ones.
+    RelaxedCounter<int> rc;
+    std::thread t3([&rc]{ ++rc; });
+    std::thread t4([&rc]{ ++rc; });
+    t3.join();
+    t4.join();
+    std::cout << rc << '\n';
+
     detecting_and_reacting();
+    detecting_and_reacting_stream();
+#if defined(__linux__)
+    detecting_and_reacting_processes();
+#endif
+
+    std::cout << "litmus: relaxed counter total " << litmus_counter() << " (expect 400000)\n";
+    std::cout << "litmus: message passing, stale reads " << litmus_message_passing(20000)
+              << " (expect 0)\n";
+    std::cout << "litmus: store buffering, both 0 with release/acquire "
+              << litmus_store_buffering<std::memory_order_release, std::memory_order_acquire>(20000)
+              << " (allowed), with seq_cst "
+              << litmus_store_buffering<std::memory_order_seq_cst, std::memory_order_seq_cst>(20000)
+              << " (expect 0)\n";
 
 }
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include "../common/AllocCounter.hpp"
+#include "../common/Counted.hpp"
 
 class Widget {
 public:
@@ -68,6 +70,117 @@ private:
     std::string text;
 };
 
+// The claims above, measured. CountingString tallies its copies and moves,
+// AllocCounter.hpp counts every heap allocation, and the ALLOC_SITE in each
+// addName tells allocations inside the function apart from those the caller
+// made building the argument. The names are long enough that copying one
+// needs the heap.
+using CountingString = instrument::Counted<std::string>;
+
+class WidgetOverloads {
+public:
+    WidgetOverloads() { names.reserve(8); }
+    void addName(const CountingString& newName)
+    {
+        ALLOC_SITE(__PRETTY_FUNCTION__);
+        names.push_back(newName);
+    }
+    void addName(CountingString&& newName)
+    {
+        ALLOC_SITE(__PRETTY_FUNCTION__);
+        names.push_back(std::move(newName));
+    }
+private:
+    std::vector<CountingString> names;
+};
+
+class WidgetForwarding {
+public:
+    WidgetForwarding() { names.reserve(8); }
+    template<typename T>
+    void addName(T&& newName)
+    {
+        ALLOC_SITE(__PRETTY_FUNCTION__);
+        names.push_back(std::forward<T>(newName));
+    }
+private:
+    std::vector<CountingString> names;
+};
+
+class WidgetByValue {
+public:
+    WidgetByValue() { names.reserve(8); }
+    void addName(CountingString newName)
+    {
+        ALLOC_SITE(__PRETTY_FUNCTION__);
+        names.push_back(std::move(newName));
+    }
+private:
+    std::vector<CountingString> names;
+};
+
+template<typename T, typename F>
+void report(const char* what, F f)
+{
+    instrument::LifetimeScope<T> lifetimes;
+    instrument::AllocScope allocs;
+    f();
+    auto l = lifetimes.delta();
+    std::cout << "  " << what << ": " << l.copies() << " copies, " << l.moves()
+              << " moves, " << allocs.delta().allocations << " allocations\n";
+}
+
+// For classes holding a plain std::string, whose copies and moves nothing
+// counts: only the allocations.
+template<typename F>
+void reportAllocs(const char* what, F f)
+{
+    instrument::AllocScope allocs;
+    f();
+    std::cout << "  " << what << ": " << allocs.delta().allocations << " allocations\n";
+}
+
+template<typename W>
+void measureAddName(const char* strategy)
+{
+    std::cout << strategy << '\n';
+    W w;
+    CountingString name("Supercalifragilisticexpialidocious");
+    report<std::string>("lvalue ", [&] { w.addName(name); });
+    report<std::string>("rvalue ", [&] { w.addName(std::move(name)); });
+    report<std::string>("literal", [&] { w.addName("Beware the Jabberwock, my son"); });
+}
+
+using CountingPtr = instrument::Counted<std::unique_ptr<std::string>>;
+
+class PtrByValue {
+public:
+    void setPtr(CountingPtr ptr) { p = std::move(ptr); }
+private:
+    CountingPtr p { nullptr };
+};
+
+class PtrByRvalueRef {
+public:
+    void setPtr(CountingPtr&& ptr) { p = std::move(ptr); }
+private:
+    CountingPtr p { nullptr };
+};
+
+// changeTo by value always allocates for the copy; by const& assigning into
+// text can reuse its capacity when the new password is no longer.
+class PasswordByRef {
+public:
+    explicit PasswordByRef(std::string pwd)
+        : text(std::move(pwd)) {}
+    void changeTo(const std::string& newPwd)
+    {
+        text = newPwd;
+    }
+private:
+    std::string text;
+};
+
 int main()
 {
     Widget w;
@@ -81,4 +194,25 @@ int main()
     std::string newPassword = "Beware the Jabberwock";
     p.changeTo(newPassword);
 
+
+    measureAddName<WidgetOverloads>("addName overloaded for const& and &&");
+    measureAddName<WidgetForwarding>("addName taking a universal reference");
+    measureAddName<WidgetByValue>("addName taking by value");
+
+    std::cout << "setPtr\n";
+    CountingPtr ptr1(std::make_unique<std::string>("Morden C++"));
+    CountingPtr ptr2(std::make_unique<std::string>("Morden C++"));
+    PtrByValue w1;
+    PtrByRvalueRef w2;
+    report<std::unique_ptr<std::string>>("by value     ", [&] { w1.setPtr(std::move(ptr1)); });
+    report<std::unique_ptr<std::string>>("by rvalue ref", [&] { w2.setPtr(std::move(ptr2)); });
+
+    std::cout << "changeTo a shorter password\n";
+    Password byValue(initPwd);
+    PasswordByRef byRef(initPwd);
+    reportAllocs("by value", [&] { byValue.changeTo(newPassword); });
+    reportAllocs("by const&", [&] { byRef.changeTo(newPassword); });
+
+    std::cout << "allocations by site\n";
+    instrument::dumpAllocSites(std::cout);
 }
@@ -0,0 +1,54 @@
+#include <string>
+#include <vector>
+#include "../common/Bench.hpp"
+
+
+// push_back("xyzzy") builds a temporary std::string, moves it into the
+// vector and destroys it; emplace_back("xyzzy") constructs in place. Short
+// strings fit in the small-string buffer, long ones need a heap allocation
+// either way. The vector is cleared but keeps its capacity between
+// repetitions, so only element construction is measured.
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item42", argc, argv);
+
+    constexpr std::size_t n = 10000;
+    std::vector<std::string> vs;
+    vs.reserve(n);
+    auto reset = [&] { vs.clear(); };
+    const std::string longStr(50, 'x');
+
+    runner.runBatch("short: push_back(\"xyzzy\")", n, reset, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            vs.push_back("xyzzy");
+        bench::doNotOptimize(vs);
+    });
+    runner.runBatch("short: emplace_back(\"xyzzy\")", n, reset, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            vs.emplace_back("xyzzy");
+        bench::doNotOptimize(vs);
+    });
+    runner.runBatch("long: push_back(std::string(50, 'x'))", n, reset, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            vs.push_back(std::string(50, 'x'));
+        bench::doNotOptimize(vs);
+    });
+    runner.runBatch("long: emplace_back(50, 'x')", n, reset, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            vs.emplace_back(50, 'x');
+        bench::doNotOptimize(vs);
+    });
+    runner.runBatch("lvalue: push_back(str)", n, reset, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            vs.push_back(longStr);
+        bench::doNotOptimize(vs);
+    });
+    runner.runBatch("lvalue: emplace_back(str)", n, reset, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            vs.emplace_back(longStr);
+        bench::doNotOptimize(vs);
+    });
+
+    return runner.finish();
+}
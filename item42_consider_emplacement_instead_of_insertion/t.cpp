@@ -5,6 +5,9 @@
 #include <iostream>
 #include <list>
 #include <regex>
+#include <memory>
+#include "../common/AllocCounter.hpp"
+#include "../common/Counted.hpp"
 
 class Widget {
 public:
@@ -22,6 +25,36 @@ void killWidget(Widget* pWidget)
     delete pWidget;
 }
 
+// push_back vs emplace_back, measured: a string type that counts its
+// constructions, copies and moves, and a count of every heap allocation.
+// The literal is too long for the small-string buffer, so each std::string
+// built from it allocates.
+using CountingString = instrument::Counted<std::string>;
+
+template<typename F>
+void report(const char* what, F f)
+{
+    instrument::LifetimeScope<std::string> lifetimes;
+    instrument::AllocScope allocs;
+    f();
+    auto l = lifetimes.delta();
+    std::cout << "  " << what << ": " << l.valueConstructs << " constructs, "
+              << l.copies() << " copies, " << l.moves() << " moves, "
+              << l.destructs << " destructs, " << allocs.delta().allocations << " allocations\n";
+}
+
+void measureInsertion()
+{
+    std::vector<CountingString> counted;
+    counted.reserve(8);  // growth isn't what's being measured
+    const std::string queenOfDisco("Donna Summer, the Queen of Disco");
+    std::cout << "vector<CountingString>\n";
+    report("push_back(\"xyzzy...\")   ", [&] { counted.push_back("xyzzy, plugh and plover"); });
+    report("emplace_back(\"xyzzy...\")", [&] { counted.emplace_back("xyzzy, plugh and plover"); });
+    report("push_back(queenOfDisco)   ", [&] { counted.push_back(queenOfDisco); });
+    report("emplace_back(queenOfDisco)", [&] { counted.emplace_back(queenOfDisco); });
+}
+
 int main()
 {
     std::vector<std::string> vs;
@@ -60,6 +93,7 @@ int main()
 
     std::copy(vs.begin(), vs.end(), std::ostream_iterator<std::string>(std::cout, " "));
     std::cout << '\n';
+    measureInsertion();
 
     // when deciding whether to use emplacement functions, two other issues are worth keeping
     // in mind. The first regards resource management.
@@ -107,4 +141,5 @@ int main()
     // In the call to emplace_back, we're passing a constructor argument for a std::regex object.
     // That's not considered an implicit conversion request. It's viewed as if you'd written this code:
     // std::regex r(nullptr);   this compiles
+
 }
@@ -0,0 +1,179 @@
+#ifndef __FLAT_COMBINER__H__
+#define __FLAT_COMBINER__H__
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+
+// Flat combining: instead of every thread taking the lock to run its own
+// critical section, a thread publishes the operation in a slot and tries to
+// take the lock. Whoever gets it becomes the combiner and runs every pending
+// operation it finds, handing each result back through its slot. Under high
+// contention one thread does the work in a batch while the protected data
+// stays in its cache, and the others just wait for their slot to complete.
+//
+// execute(f) runs f under the combiner's lock and returns what it returns,
+// exceptions included. f must not call execute on the same combiner.
+template<typename Mutex = std::mutex, std::size_t Slots = 64>
+class FlatCombiner {
+public:
+    FlatCombiner() = default;
+    FlatCombiner(const FlatCombiner&) = delete;
+    FlatCombiner& operator=(const FlatCombiner&) = delete;
+
+    template<typename F>
+    decltype(auto) execute(F&& f)
+    {
+        using R = decltype(f());
+        static_assert(!std::is_reference<R>::value,
+                      "results are handed back by value; return a pointer instead");
+        Op<std::remove_reference_t<F>, R> op(f);
+        publishAndWait(op);
+        return op.take();
+    }
+
+    // Operations run so far, and in how many combining passes. Their ratio
+    // is the average batch size.
+    std::size_t operations() const noexcept { return ops.load(std::memory_order_relaxed); }
+    std::size_t passes() const noexcept { return combines.load(std::memory_order_relaxed); }
+
+private:
+    struct OpBase {
+        void (*run)(OpBase*);
+    };
+
+    // The closure, a place for its result and for an exception, all on the
+    // caller's stack; the combiner only ever sees an OpBase*.
+    template<typename F, typename R>
+    struct Op : OpBase {
+        explicit Op(F& func) : f(func) { this->run = &Op::invoke; }
+        ~Op() { if (hasValue) value()->~R(); }
+
+        static void invoke(OpBase* base)
+        {
+            auto self = static_cast<Op*>(base);
+            try {
+                ::new (&self->storage) R(self->f());
+                self->hasValue = true;
+            } catch (...) {
+                self->error = std::current_exception();
+            }
+        }
+        R take()
+        {
+            if (error)
+                std::rethrow_exception(error);
+            return std::move(*value());
+        }
+        R* value() { return reinterpret_cast<R*>(&storage); }
+
+        F& f;
+        std::aligned_storage_t<sizeof(R), alignof(R)> storage;
+        bool hasValue { false };
+        std::exception_ptr error;
+    };
+
+    template<typename F>
+    struct Op<F, void> : OpBase {
+        explicit Op(F& func) : f(func) { this->run = &Op::invoke; }
+
+        static void invoke(OpBase* base)
+        {
+            auto self = static_cast<Op*>(base);
+            try {
+                self->f();
+            } catch (...) {
+                self->error = std::current_exception();
+            }
+        }
+        void take()
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        F& f;
+        std::exception_ptr error;
+    };
+
+    enum : int { empty, claimed, pending, done };
+
+    // One cache line per slot, so publishing doesn't false-share.
+    struct alignas(64) Slot {
+        std::atomic<int> state { empty };
+        OpBase* op { nullptr };
+    };
+
+    static std::size_t preferredSlot() noexcept
+    {
+        static std::atomic<std::size_t> nextThread { 0 };
+        static thread_local std::size_t id = nextThread.fetch_add(1, std::memory_order_relaxed);
+        return id % Slots;
+    }
+
+    Slot& claimSlot() noexcept
+    {
+        for (auto i = preferredSlot();; i = (i + 1) % Slots) {
+            auto expected = static_cast<int>(empty);
+            if (slots[i].state.compare_exchange_strong(expected, claimed,
+                                                       std::memory_order_acquire)) {
+                // combine() only scans up to the highest slot ever used
+                auto n = used.load(std::memory_order_relaxed);
+                while (n <= i && !used.compare_exchange_weak(n, i + 1, std::memory_order_release))
+                    ;
+                return slots[i];
+            }
+            // more threads than slots: keep probing, someone will finish
+            if (i == Slots - 1)
+                std::this_thread::yield();
+        }
+    }
+
+    void publishAndWait(OpBase& op)
+    {
+        auto& slot = claimSlot();
+        slot.op = &op;
+        slot.state.store(pending, std::memory_order_release);
+        for (unsigned spins = 0; slot.state.load(std::memory_order_acquire) != done; ++spins) {
+            if (mutex.try_lock()) {
+                combine();
+                mutex.unlock();
+            } else if (spins > 64) {
+                std::this_thread::yield();
+            }
+        }
+        slot.state.store(empty, std::memory_order_release);
+    }
+
+    // Runs with the lock held.
+    void combine()
+    {
+        std::size_t n = 0;
+        auto end = slots + used.load(std::memory_order_acquire);
+        for (auto slot = slots; slot != end; ++slot) {
+            if (slot->state.load(std::memory_order_acquire) == pending) {
+                slot->op->run(slot->op);
+                slot->state.store(done, std::memory_order_release);
+                ++n;
+            }
+        }
+        if (n == 0)
+            return;
+        ops.store(ops.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        combines.store(combines.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    Slot slots[Slots];
+    std::atomic<std::size_t> used { 0 };
+    Mutex mutex;
+    std::atomic<std::size_t> ops { 0 };
+    std::atomic<std::size_t> combines { 0 };
+};
+
+#endif // __FLAT_COMBINER__H__
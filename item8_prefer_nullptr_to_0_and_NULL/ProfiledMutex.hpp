@@ -0,0 +1,284 @@
+#ifndef __PROFILED_MUTEX__H__
+#define __PROFILED_MUTEX__H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+// ProfiledMutex<M> wraps a mutex M and records, per lock:
+//   - how many acquisitions there were, and how many found the lock taken
+//   - how long contended acquisitions waited
+//   - how long the lock was held
+// Times go into log2 histograms, so dumps show the shape of the distribution,
+// not just an average.
+//
+// It meets the Lockable requirements, so it can stand in for std::mutex in
+// std::lock_guard, std::unique_lock or lockAndCall's MuxType.
+//
+// The uncontended path is a try_lock plus two timestamp reads. Timestamps
+// are raw TSC ticks on x86 (a few ns each, no syscall) and steady_clock
+// elsewhere; ticks are only converted to ns when dumping. All statistics are
+// updated by the thread holding the lock, so they're plain relaxed loads and
+// stores, no read-modify-write.
+namespace lockprof {
+
+inline std::uint64_t ticks() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Ticks per nanosecond, measured once against steady_clock on first use.
+inline double ticksPerNs()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const double ratio = [] {
+        auto t0 = std::chrono::steady_clock::now();
+        auto c0 = ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto c1 = ticks();
+        auto t1 = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        return (c1 - c0) / ns;
+    }();
+    return ratio;
+#else
+    return 1.0;
+#endif
+}
+
+// Bucket i counts samples in [2^i, 2^(i+1)) ticks; bucket 0 also takes 0.
+class Histogram {
+public:
+    static constexpr std::size_t buckets = 64;
+
+    // Only called with the lock held, see above.
+    void record(std::uint64_t v) noexcept
+    {
+        auto b = v ? 63 - __builtin_clzll(v) : 0;
+        bump(counts[b], 1);
+        bump(total, v);
+        if (v > max.load(std::memory_order_relaxed))
+            max.store(v, std::memory_order_relaxed);
+    }
+
+    std::uint64_t count(std::size_t bucket) const noexcept
+    {
+        return counts[bucket].load(std::memory_order_relaxed);
+    }
+    std::uint64_t sum() const noexcept { return total.load(std::memory_order_relaxed); }
+    std::uint64_t maximum() const noexcept { return max.load(std::memory_order_relaxed); }
+    std::uint64_t samples() const noexcept
+    {
+        std::uint64_t n = 0;
+        for (std::size_t i = 0; i < buckets; ++i)
+            n += count(i);
+        return n;
+    }
+
+    // Smallest bucket upper bound below which fraction q of samples lie.
+    std::uint64_t quantile(double q) const noexcept
+    {
+        auto n = samples();
+        if (n == 0)
+            return 0;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets; ++i) {
+            seen += count(i);
+            if (seen >= q * n)
+                return i >= 63 ? ~std::uint64_t(0) : (std::uint64_t(2) << i);
+        }
+        return maximum();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& c : counts)
+            c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static void bump(std::atomic<std::uint64_t>& a, std::uint64_t by) noexcept
+    {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::uint64_t> counts[buckets] {};
+    std::atomic<std::uint64_t> total { 0 };
+    std::atomic<std::uint64_t> max { 0 };
+};
+
+struct LockStats {
+    std::atomic<std::uint64_t> acquisitions { 0 };
+    std::atomic<std::uint64_t> contended { 0 };
+    Histogram wait;   // contended acquisitions only
+    Histogram hold;
+
+    void reset() noexcept
+    {
+        acquisitions.store(0, std::memory_order_relaxed);
+        contended.store(0, std::memory_order_relaxed);
+        wait.reset();
+        hold.reset();
+    }
+};
+
+void dumpStats(std::ostream& os, const std::string& name, const LockStats& s);
+
+// All live profiled mutexes, for dumpAll().
+class Registry {
+public:
+    static Registry& instance()
+    {
+        static Registry r;
+        return r;
+    }
+    void add(const std::string* name, const LockStats* stats)
+    {
+        std::lock_guard<std::mutex> g(m);
+        entries.push_back({ name, stats });
+    }
+    void remove(const LockStats* stats)
+    {
+        std::lock_guard<std::mutex> g(m);
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [stats](const Entry& e) { return e.stats == stats; }),
+                      entries.end());
+    }
+    void dumpAll(std::ostream& os)
+    {
+        std::lock_guard<std::mutex> g(m);
+        for (const auto& e : entries)
+            dumpStats(os, *e.name, *e.stats);
+    }
+private:
+    struct Entry {
+        const std::string* name;
+        const LockStats* stats;
+    };
+    std::mutex m;
+    std::vector<Entry> entries;
+};
+
+inline void dumpStats(std::ostream& os, const std::string& name, const LockStats& s)
+{
+    auto perNs = ticksPerNs();
+    auto ns = [perNs](std::uint64_t t) { return static_cast<double>(t) / perNs; };
+    auto acq = s.acquisitions.load(std::memory_order_relaxed);
+    auto cont = s.contended.load(std::memory_order_relaxed);
+    std::ios_base::fmtflags flags(os.flags());
+    auto precision = os.precision();
+    os << std::fixed << std::setprecision(1);
+    os << "lock " << name << ": " << acq << " acquisitions, " << cont << " contended ("
+       << (acq ? 100.0 * cont / acq : 0.0) << "%)\n";
+    auto line = [&](const char* what, const Histogram& h) {
+        auto n = h.samples();
+        os << "  " << what << " ns: mean " << (n ? ns(h.sum()) / n : 0.0)
+           << "  p50 <" << ns(h.quantile(0.5)) << "  p99 <" << ns(h.quantile(0.99))
+           << "  max " << ns(h.maximum()) << '\n';
+        for (std::size_t i = 0; i < Histogram::buckets; ++i) {
+            if (auto c = h.count(i))
+                os << "    [" << std::setw(12) << ns(i ? std::uint64_t(1) << i : 0) << ", "
+                   << std::setw(12) << ns(std::uint64_t(2) << i) << ") " << c << '\n';
+        }
+    };
+    line("wait", s.wait);
+    line("hold", s.hold);
+    os.flags(flags);
+    os.precision(precision);
+}
+
+// Dumps every live ProfiledMutex.
+inline void dumpAll(std::ostream& os)
+{
+    Registry::instance().dumpAll(os);
+}
+
+} // namespace lockprof
+
+
+template<typename Mutex = std::mutex>
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(std::string lockName)
+        : name(std::move(lockName))
+    {
+        lockprof::Registry::instance().add(&name, &stats);
+    }
+    ~ProfiledMutex()
+    {
+        lockprof::Registry::instance().remove(&stats);
+    }
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    void lock()
+    {
+        if (mutex.try_lock()) {
+            acquiredAt = lockprof::ticks();
+        } else {
+            auto start = lockprof::ticks();
+            mutex.lock();
+            acquiredAt = lockprof::ticks();
+            bump(stats.contended);
+            stats.wait.record(acquiredAt - start);
+        }
+        bump(stats.acquisitions);
+    }
+
+    bool try_lock()
+    {
+        if (!mutex.try_lock())
+            return false;
+        acquiredAt = lockprof::ticks();
+        bump(stats.acquisitions);
+        return true;
+    }
+
+    void unlock()
+    {
+        stats.hold.record(lockprof::ticks() - acquiredAt);
+        mutex.unlock();
+    }
+
+    const std::string& lockName() const noexcept { return name; }
+    const lockprof::LockStats& profile() const noexcept { return stats; }
+
+    // Only meaningful while no one is using the lock.
+    void resetProfile() noexcept { stats.reset(); }
+
+    void dump(std::ostream& os) const { lockprof::dumpStats(os, name, stats); }
+
+private:
+    static void bump(std::atomic<std::uint64_t>& a) noexcept
+    {
+        a.store(a.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    Mutex mutex;
+    std::uint64_t acquiredAt { 0 };  // written and read only by the holder
+    std::string name;
+    lockprof::LockStats stats;
+};
+
+#endif // __PROFILED_MUTEX__H__
@@ -0,0 +1,86 @@
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/AdaptiveMutex.hpp"
+#include "../common/Bench.hpp"
+#include "FlatCombiner.hpp"
+#include "ProfiledMutex.hpp"
+
+
+// 1. What profiling costs on the path that matters most: an uncontended
+//    lock/unlock pair.
+// 2. Throughput of a tiny critical section (bump a shared counter) from 1 to
+//    64 threads, with std::lock_guard over std::mutex and over AdaptiveMutex,
+//    and a FlatCombiner. ns/op is wall time divided by the total operations
+//    of all threads.
+
+constexpr std::size_t opsPerThread = 20000;
+
+template<typename F>
+void runThreads(int n, F f)
+{
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; ++i)
+        threads.emplace_back([&f] {
+            for (std::size_t j = 0; j < opsPerThread; ++j)
+                f();
+        });
+    for (auto& t : threads)
+        t.join();
+}
+
+int main(int argc, char* argv[])
+{
+    bench::Runner runner("item8", argc, argv);
+
+    std::mutex plain;
+    ProfiledMutex<> profiled("bench");
+    AdaptiveMutex adaptive;
+    int counter = 0;
+
+    runner.run("uncontended: std::mutex", [&] {
+        std::lock_guard<std::mutex> g(plain);
+        ++counter;
+    });
+    runner.run("uncontended: ProfiledMutex<std::mutex>", [&] {
+        std::lock_guard<ProfiledMutex<>> g(profiled);
+        ++counter;
+    });
+    runner.run("uncontended: AdaptiveMutex", [&] {
+        std::lock_guard<AdaptiveMutex> g(adaptive);
+        ++counter;
+    });
+
+    std::mutex m;
+    FlatCombiner<> combiner;
+    for (int n : { 1, 2, 4, 8, 16, 32, 64 }) {
+        auto ops = n * opsPerThread;
+        auto suffix = " (" + std::to_string(n) + " threads)";
+        runner.runBatch("lock_guard" + suffix, ops, [&] {
+            runThreads(n, [&] {
+                std::lock_guard<std::mutex> g(m);
+                ++counter;
+            });
+        });
+        auto r = runner.runBatch("adaptive mutex" + suffix, ops, [&] {
+            runThreads(n, [&] {
+                std::lock_guard<AdaptiveMutex> g(adaptive);
+                ++counter;
+            });
+        });
+        if (r)
+            runner.counter(r, "spin budget", adaptive.spinBudget());
+        auto ops0 = combiner.operations();
+        auto passes0 = combiner.passes();
+        r = runner.runBatch("flat combining" + suffix, ops, [&] {
+            runThreads(n, [&] { combiner.execute([&] { return ++counter; }); });
+        });
+        if (r)
+            runner.counter(r, "ops per combining pass",
+                           double(combiner.operations() - ops0) / (combiner.passes() - passes0));
+    }
+
+    bench::doNotOptimize(counter);
+    return runner.finish();
+}
@@ -1,6 +1,11 @@
 #include <mutex>
 #include <memory>
 #include <iostream>
+#include <thread>
+#include <vector>
+#include "../common/AdaptiveMutex.hpp"
+#include "FlatCombiner.hpp"
+#include "ProfiledMutex.hpp"
 
 // the issue here it that, neither 0 nor NULL has a pointer type.
 
@@ -68,10 +73,23 @@ template<typename FuncType,
          typename PtrType>
 decltype(auto) lockAndCall(FuncType func, MuxType& mutex, PtrType ptr)
 {
-    MuxGuard g(mutex);
+    // lock_guard of MuxType rather than MuxGuard, so any Lockable type works,
+    // e.g. ProfiledMutex or AdaptiveMutex
+    std::lock_guard<MuxType> g(mutex);
     return func(ptr);
 }
 
+// Flat-combining mode: pass a FlatCombiner instead of a mutex, and under
+// contention one thread runs everybody's func(ptr) calls in a batch.
+template<typename FuncType,
+         typename MuxType,
+         std::size_t Slots,
+         typename PtrType>
+decltype(auto) lockAndCall(FuncType func, FlatCombiner<MuxType, Slots>& combiner, PtrType ptr)
+{
+    return combiner.execute([&] { return func(ptr); });
+}
+
 int main()
 {
     // the following repeated pattern in the calling code is disturbing.
@@ -98,4 +116,49 @@ int main()
     auto result3 = lockAndCall(f3, f3m, nullptr);
     std::cout << result3 << '\n';
 
+
+    // the same call through a profiled mutex, from a few threads at once
+    ProfiledMutex<> f3pm("f3pm");
+    Widget w(1, 2.0, true);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 100000; ++j)
+                lockAndCall(f3, f3pm, &w);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    lockprof::dumpAll(std::cout);
+
+    // f3 holds the lock for a few ns: spinning briefly beats sleeping
+    AdaptiveMutex f3am;
+    threads.clear();
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 100000; ++j)
+                lockAndCall(f3, f3am, &w);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    std::cout << "adaptive mutex: spin budget " << f3am.spinBudget() << '\n';
+
+    FlatCombiner<> f1fc;
+    auto spw = std::make_shared<Widget>(3, 4.0, false);
+    int total = 0;
+    threads.clear();
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 100000; ++j) {
+                // total is only touched inside the combiner, one op at a time
+                lockAndCall([&total](std::shared_ptr<Widget> p) { return total += f1(p); },
+                            f1fc, spw);
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    std::cout << "flat combining: total " << total << " from " << f1fc.operations()
+              << " operations in " << f1fc.passes() << " combining passes\n";
 }